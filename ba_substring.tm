@@ -0,0 +1,11 @@
+# Example nondeterministic 1-tape Turing machine (run with tm_interpreter -nd),
+# recognizing words over {a,b} containing "ba"
+
+num-tapes: 1
+input-alphabet: a b
+
+# guess the position of "ba"
+(start) a (start) a >
+(start) b (start) b >
+(start) b (seen) b >
+(seen) a (accept) a -
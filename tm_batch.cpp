@@ -0,0 +1,224 @@
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include "tm_batch.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BATCH_HAS_AVX2
+#endif
+
+using namespace std;
+
+namespace {
+
+// Configurations of all lanes: tape `a` of lane `l` is tapes[(l * num_tapes + a) * capacity ...]
+struct Lanes
+{
+    int32_t state[BatchRunner::BATCH_LANES];
+    vector<int32_t> heads; // heads[a * BATCH_LANES + l]
+    vector<int32_t> tapes;
+    int32_t capacity;
+};
+
+struct Table
+{
+    int num_tapes;
+    int32_t num_letters;
+    const int32_t *next_state;
+    vector<const int32_t *> new_letter, head_move;
+};
+
+// Lanes which need attention: halted, head fell off or reached the end of allocated tape
+inline bool needs_attention(int32_t state, int32_t head, int32_t capacity)
+{
+    return state < DENSE_IDLE || head < 0 || head >= capacity;
+}
+
+unsigned step_scalar(Lanes &lanes, const Table &table)
+{
+    const int L = BatchRunner::BATCH_LANES;
+    unsigned attention = 0;
+    for (int l = 0; l < L; ++l)
+    {
+        int32_t index = lanes.state[l];
+        for (int a = 0; a < table.num_tapes; ++a)
+            index = index * table.num_letters + lanes.tapes[(l * table.num_tapes + a) * lanes.capacity + lanes.heads[a * L + l]];
+        lanes.state[l] = table.next_state[index];
+        for (int a = 0; a < table.num_tapes; ++a)
+        {
+            int32_t &head = lanes.heads[a * L + l];
+            lanes.tapes[(l * table.num_tapes + a) * lanes.capacity + head] = table.new_letter[a][index];
+            head += table.head_move[a][index];
+            if (needs_attention(lanes.state[l], head, lanes.capacity))
+                attention |= 1u << l;
+        }
+    }
+    return attention;
+}
+
+#ifdef BATCH_HAS_AVX2
+__attribute__((target("avx2")))
+unsigned step_avx2(Lanes &lanes, const Table &table)
+{
+    const int L = BatchRunner::BATCH_LANES;
+    const __m256i lane_ids = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i letters = _mm256_set1_epi32(table.num_letters);
+    const __m256i tape_stride = _mm256_set1_epi32(table.num_tapes * lanes.capacity);
+
+    __m256i index = _mm256_loadu_si256((const __m256i *)lanes.state);
+    __m256i cells[8];
+    for (int a = 0; a < table.num_tapes; ++a)
+    {
+        __m256i head = _mm256_loadu_si256((const __m256i *)&lanes.heads[a * L]);
+        cells[a] = _mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi32(lane_ids, tape_stride), 
+            _mm256_set1_epi32(a * lanes.capacity)), head);
+        __m256i letter = _mm256_i32gather_epi32(lanes.tapes.data(), cells[a], 4);
+        index = _mm256_add_epi32(_mm256_mullo_epi32(index, letters), letter);
+    }
+    __m256i state = _mm256_i32gather_epi32(table.next_state, index, 4);
+    _mm256_storeu_si256((__m256i *)lanes.state, state);
+
+    __m256i attention = _mm256_cmpgt_epi32(_mm256_set1_epi32(DENSE_IDLE), state);
+    const __m256i capacity = _mm256_set1_epi32(lanes.capacity - 1);
+    alignas(32) int32_t written[L], cell[L];
+    for (int a = 0; a < table.num_tapes; ++a)
+    {
+        // No scatter in AVX2 - letters are written one by one
+        _mm256_store_si256((__m256i *)written, _mm256_i32gather_epi32(table.new_letter[a], index, 4));
+        _mm256_store_si256((__m256i *)cell, cells[a]);
+        for (int l = 0; l < L; ++l)
+            lanes.tapes[cell[l]] = written[l];
+
+        __m256i head = _mm256_loadu_si256((const __m256i *)&lanes.heads[a * L]);
+        head = _mm256_add_epi32(head, _mm256_i32gather_epi32(table.head_move[a], index, 4));
+        _mm256_storeu_si256((__m256i *)&lanes.heads[a * L], head);
+        attention = _mm256_or_si256(attention, _mm256_or_si256(_mm256_cmpgt_epi32(_mm256_setzero_si256(), head),
+            _mm256_cmpgt_epi32(head, capacity)));
+    }
+    return _mm256_movemask_ps(_mm256_castsi256_ps(attention));
+}
+#endif
+
+}
+
+vector<BatchResult> BatchRunner::run(const vector<vector<string>> &inputs, size_t max_steps,
+    vector<size_t> *steps, bool use_simd) const
+{
+    const int L = BATCH_LANES;
+    const int num_tapes = dense.num_tapes;
+    Table table{num_tapes, dense.num_letters, dense.next_state.data(), {}, {}};
+    for (int a = 0; a < num_tapes; ++a)
+    {
+        table.new_letter.push_back(dense.new_letter[a].data());
+        table.head_move.push_back(dense.head_move[a].data());
+    }
+    auto step = step_scalar;
+#ifdef BATCH_HAS_AVX2
+    if (use_simd && num_tapes <= 8 && __builtin_cpu_supports("avx2"))
+        step = step_avx2;
+#endif
+
+    size_t longest = 0;
+    for (auto &input : inputs)
+        longest = max(longest, input.size());
+    Lanes lanes;
+    lanes.capacity = 16;
+    while ((size_t)lanes.capacity < 2 * longest + 1)
+        lanes.capacity *= 2;
+    lanes.heads.assign(num_tapes * L, 0);
+    lanes.tapes.assign((size_t)L * num_tapes * lanes.capacity, 0);
+
+    vector<BatchResult> results(inputs.size(), BATCH_LIMIT);
+    if (steps)
+        steps->assign(inputs.size(), 0);
+    size_t next_input = 0, running = 0;
+    size_t input_of[L], started[L];
+    size_t iteration = 0;
+
+    auto tape = [&](int l, int a) { return lanes.tapes.begin() + (size_t)(l * num_tapes + a) * lanes.capacity; };
+    auto load = [&](int l) {
+        for (int a = 0; a < num_tapes; ++a)
+        {
+            fill(tape(l, a), tape(l, a) + lanes.capacity, 0);
+            lanes.heads[a * L + l] = 0;
+        }
+        if (next_input == inputs.size())
+        {
+            lanes.state[l] = DENSE_IDLE;
+            return;
+        }
+        input_of[l] = next_input++;
+        started[l] = iteration;
+        lanes.state[l] = dense.initial;
+        auto &input = inputs[input_of[l]];
+        for (size_t a = 0; a < input.size(); ++a)
+            tape(l, 0)[a] = dense.letter_ids.at(input[a]);
+        ++running;
+    };
+    // stuck - the last iteration was not a step (no transition or a head fell off)
+    auto retire = [&](int l, BatchResult result, bool stuck = false) {
+        results[input_of[l]] = result;
+        if (steps)
+            (*steps)[input_of[l]] = iteration - started[l] - stuck;
+        --running;
+        load(l);
+    };
+    auto grow = [&]() {
+        if ((size_t)L * num_tapes * lanes.capacity * 2 > INT32_MAX)
+            throw length_error("Tapes are too long for the batch engine");
+        vector<int32_t> tapes((size_t)L * num_tapes * lanes.capacity * 2, 0);
+        for (size_t t = 0; t < (size_t)L * num_tapes; ++t)
+            copy(lanes.tapes.begin() + t * lanes.capacity, lanes.tapes.begin() + (t + 1) * lanes.capacity, 
+                tapes.begin() + t * lanes.capacity * 2);
+        lanes.tapes.swap(tapes);
+        lanes.capacity *= 2;
+    };
+
+    // Earliest step at which some lane reaches max_steps
+    size_t deadline = 0;
+    auto update_deadline = [&]() {
+        deadline = SIZE_MAX;
+        for (int l = 0; l < L; ++l)
+            if (lanes.state[l] != DENSE_IDLE)
+                deadline = min(deadline, started[l] + max_steps);
+    };
+    for (int l = 0; l < L; ++l)
+        load(l);
+    update_deadline();
+    while (running)
+    {
+        unsigned attention = step(lanes, table);
+        ++iteration;
+        if (!attention && iteration < deadline)
+            continue;
+        for (int l = 0; l < L; ++l)
+        {
+            if (lanes.state[l] == DENSE_IDLE)
+                continue;
+            if (attention & (1u << l))
+            {
+                bool fell_off = false, too_long = false;
+                for (int a = 0; a < num_tapes; ++a)
+                {
+                    fell_off |= lanes.heads[a * L + l] < 0;
+                    too_long |= lanes.heads[a * L + l] >= lanes.capacity;
+                }
+                if (fell_off || lanes.state[l] < DENSE_IDLE)
+                {
+                    retire(l, lanes.state[l] == DENSE_ACCEPT && !fell_off ? BATCH_ACCEPT : BATCH_REJECT,
+                        fell_off || lanes.state[l] == DENSE_NO_TRANSITION);
+                    continue;
+                }
+                if (too_long)
+                    grow();
+            }
+            if (iteration - started[l] >= max_steps)
+                retire(l, BATCH_LIMIT);
+        }
+        update_deadline();
+    }
+    return results;
+}
@@ -0,0 +1,33 @@
+#ifndef __TM_BATCH_H
+#define __TM_BATCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "turing_machine.h"
+#include "tm_layout.h"
+#include "tm_dense.h"
+
+enum BatchResult { BATCH_ACCEPT, BATCH_REJECT, BATCH_LIMIT };
+
+// Runs many inputs of one machine in lockstep: BATCH_LANES runs are advanced together,
+// their states, heads and letters under heads are kept in arrays (one entry per run),
+// transitions are looked up in a dense table with vector gathers (AVX2 if the processor has it).
+class BatchRunner
+{
+public:
+    static const int BATCH_LANES = 8;
+
+    // layout - numbering of the dense table (see DenseMachine)
+    BatchRunner(const TuringMachine &tm, const Layout *layout = nullptr) : dense(tm, layout) {}
+
+    // Inputs must be words over the input alphabet; steps (if given) receives the number of steps of each run
+    std::vector<BatchResult> run(const std::vector<std::vector<std::string>> &inputs, size_t max_steps,
+        std::vector<size_t> *steps = nullptr, bool use_simd = true) const;
+
+private:
+    DenseMachine dense;
+};
+
+#endif
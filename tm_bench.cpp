@@ -0,0 +1,338 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "turing_machine.h"
+#include "tm_convert.h"
+#include "tm_batch.h"
+#include "tm_dense.h"
+#include "tm_simulator.h"
+
+using namespace std;
+
+// Benchmark of the code paths: reading a .tm file, constructing (validating) a machine,
+// conversion to one tape, saving and interpreting.
+// Synthetic machines are generated over a grid of (states x alphabet size x input length).
+
+static int repetitions = 5;
+static int warmup = 1;
+static size_t max_steps = 2000000; // per simulator run
+static bool quick = false;
+#define BATCH_INPUTS 64
+
+static void print_usage(string error)
+{
+    cerr << "ERROR: " << error << "\n"
+         << "Usage: tm_bench [--quick] [--reps N] [--warmup N] [--max-steps N] [--json] [-o|--output <file>]\n";
+    exit(1);
+}
+
+struct Result
+{
+    string machine;
+    int num_tapes;
+    size_t states;
+    size_t alphabet;
+    size_t input_length;
+    string operation;
+    double best_seconds;
+    double mean_seconds;
+    double items; // processed in one repetition (transitions or steps)
+};
+
+static vector<Result> results;
+
+// Runs `op` (returning the number of processed items) with warm-up and repetitions;
+// `prepare` is called before every run of `op`, outside of the measured time
+template<typename Op, typename Prepare>
+static void measure(Result result, Op op, Prepare prepare)
+{
+    for (int i = 0; i < warmup; ++i)
+    {
+        prepare();
+        op();
+    }
+    result.best_seconds = 1e100;
+    double total = 0;
+    for (int i = 0; i < repetitions; ++i)
+    {
+        prepare();
+        auto start = chrono::steady_clock::now();
+        result.items = op();
+        double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        result.best_seconds = min(result.best_seconds, elapsed);
+        total += elapsed;
+    }
+    result.mean_seconds = total / repetitions;
+    results.push_back(result);
+    cerr << result.machine << " " << result.operation << ": " << result.best_seconds << "s\n";
+}
+
+template<typename Op>
+static void measure(Result result, Op op)
+{
+    measure(result, op, []() {});
+}
+
+static string letter(size_t i)
+{
+    return "(l" + to_string(i) + ")";
+}
+
+static string state(size_t i)
+{
+    return "(q" + to_string(i) + ")";
+}
+
+// Machine walking right over the input; state is changed cyclically on every step,
+// on tape 2 (if present) every letter is copied.
+static TuringMachine synthetic_machine(int num_tapes, size_t num_states, size_t alphabet_size)
+{
+    vector<string> input_alphabet;
+    for (size_t a = 0; a < alphabet_size; ++a)
+        input_alphabet.push_back(letter(a));
+
+    transitions_t transitions;
+    for (size_t q = 0; q < num_states; ++q)
+    {
+        string from = q ? state(q) : INITIAL_STATE;
+        string to = q + 1 < num_states ? state(q + 1) : INITIAL_STATE;
+        for (auto &let : input_alphabet)
+        {
+            if (num_tapes == 1)
+                transitions[make_pair(from, vector<string>{let})] = make_tuple(to, vector<string>{let}, ">");
+            else
+                transitions[make_pair(from, vector<string>{let, BLANK})] = make_tuple(to, vector<string>{let, let}, ">>");
+        }
+        vector<string> blanks(num_tapes, BLANK);
+        transitions[make_pair(from, blanks)] = make_tuple(ACCEPTING_STATE, blanks, string(num_tapes, HEAD_STAY));
+    }
+    return TuringMachine(num_tapes, std::move(input_alphabet), std::move(transitions));
+}
+
+static string synthetic_input(const TuringMachine &tm, size_t length)
+{
+    string input;
+    for (size_t a = 0; a < length; ++a)
+        input += tm.input_alphabet()[a % tm.input_alphabet().size()];
+    return input;
+}
+
+// The file is read from memory
+static FILE *to_file(string &content)
+{
+    FILE *f = fmemopen(&content[0], content.size(), "r");
+    if (!f)
+    {
+        cerr << "ERROR: Cannot open the machine in memory\n";
+        exit(1);
+    }
+    return f;
+}
+
+static void bench_machine(const string &name, const TuringMachine &tm, size_t num_states, const vector<size_t> &input_lengths)
+{
+    Result base{name, tm.num_tapes, num_states, tm.working_alphabet().size(), 0, "", 0, 0, 0};
+    ostringstream oss;
+    tm.save_to_file(oss);
+    string text = oss.str();
+
+    // Machines are destroyed, and their parts copied, outside of the measured time
+    unique_ptr<TuringMachine> built;
+    FILE *file = nullptr;
+    base.operation = "read_tm_from_file";
+    measure(base, [&]() {
+        built = make_unique<TuringMachine>(read_tm_from_file(file));
+        return (double)built->transitions().size();
+    }, [&]() {
+        built.reset();
+        file = to_file(text);
+    });
+
+    vector<string> alphabet;
+    transitions_t transitions;
+    base.operation = "construct";
+    measure(base, [&]() {
+        built = make_unique<TuringMachine>(tm.num_tapes, std::move(alphabet), std::move(transitions));
+        return (double)built->transitions().size();
+    }, [&]() {
+        built.reset();
+        alphabet = tm.input_alphabet();
+        transitions = tm.transitions();
+    });
+    built.reset();
+
+    base.operation = "save_to_file";
+    measure(base, [&]() { ostringstream out; tm.save_to_file(out); return (double)tm.transitions().size(); });
+
+    vector<TuringMachine> machines{tm};
+    if (tm.num_tapes == 2)
+    {
+        base.operation = "tm_convert";
+        measure(base, [&]() { return (double)tm_convert(tm).transitions().size(); });
+        machines.push_back(tm_convert(tm));
+    }
+
+    for (auto &machine : machines)
+    {
+        Result run = base;
+        run.operation = machine.num_tapes == tm.num_tapes ? "steps" : "steps_converted";
+        // The path of tm_interpreter
+        Simulator simulator(machine);
+        for (size_t length : input_lengths)
+        {
+            run.input_length = length;
+            string input = synthetic_input(tm, length);
+            measure(run, [&]() {
+                simulator.reset(input);
+                simulator.run(max_steps);
+                return (double)simulator.steps();
+            });
+        }
+
+        // Dense table, step loop specialized on the number of tapes
+        DenseMachine dense(machine);
+        vector<unique_ptr<Tape>> tapes;
+        for (int a = 0; a < machine.num_tapes; ++a)
+            tapes.push_back(make_unique<VectorTape>());
+        DenseSimulator dense_simulator(dense, std::move(tapes));
+        Result fast = run;
+        fast.operation = run.operation + "_dense";
+        for (size_t length : input_lengths)
+        {
+            fast.input_length = length;
+            vector<string> word = tm.parse_input(synthetic_input(tm, length));
+            measure(fast, [&]() {
+                dense_simulator.reset(word);
+                dense_simulator.run(max_steps);
+                return (double)dense_simulator.steps();
+            });
+        }
+
+        // Lockstep runs of BATCH_INPUTS inputs (rotations of the synthetic one)
+        BatchRunner runner(machine);
+        for (bool simd : {false, true})
+        {
+            Result batch = run;
+            batch.operation = run.operation + (simd ? "_batch" : "_batch_scalar");
+            for (size_t length : input_lengths)
+            {
+                batch.input_length = length;
+                vector<string> word = tm.parse_input(synthetic_input(tm, length));
+                vector<vector<string>> inputs;
+                for (size_t a = 0; a < BATCH_INPUTS; ++a)
+                {
+                    inputs.push_back(word);
+                    if (!word.empty())
+                        rotate(word.begin(), word.begin() + 1, word.end());
+                }
+                measure(batch, [&]() {
+                    vector<size_t> steps;
+                    runner.run(inputs, max_steps, &steps, simd);
+                    size_t total = 0;
+                    for (size_t s : steps)
+                        total += s;
+                    return (double)total;
+                });
+            }
+        }
+    }
+}
+
+static void save_results(ostream &output, bool json)
+{
+    if (json)
+        output << "[\n";
+    else
+        output << "machine,num_tapes,states,alphabet,input_length,operation,repetitions,best_seconds,mean_seconds,items,items_per_second\n";
+    for (size_t a = 0; a < results.size(); ++a)
+    {
+        auto &r = results[a];
+        double per_second = r.best_seconds > 0 ? r.items / r.best_seconds : 0;
+        if (json)
+            output << "  {\"machine\": \"" << r.machine << "\", \"num_tapes\": " << r.num_tapes
+                   << ", \"states\": " << r.states << ", \"alphabet\": " << r.alphabet
+                   << ", \"input_length\": " << r.input_length << ", \"operation\": \"" << r.operation
+                   << "\", \"repetitions\": " << repetitions << ", \"best_seconds\": " << r.best_seconds
+                   << ", \"mean_seconds\": " << r.mean_seconds << ", \"items\": " << r.items
+                   << ", \"items_per_second\": " << per_second << "}" << (a + 1 < results.size() ? "," : "") << "\n";
+        else
+            output << r.machine << "," << r.num_tapes << "," << r.states << "," << r.alphabet << ","
+                   << r.input_length << "," << r.operation << "," << repetitions << "," << r.best_seconds << ","
+                   << r.mean_seconds << "," << r.items << "," << per_second << "\n";
+    }
+    if (json)
+        output << "]\n";
+}
+
+int main(int argc, char* argv[])
+{
+    string outputname;
+    bool json = false;
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        auto number = [&]() {
+            if (i + 1 >= argc)
+                print_usage("Number expected after " + arg);
+            return atol(argv[++i]);
+        };
+        if (arg == "--quick")
+            quick = true;
+        else if (arg == "--reps")
+            repetitions = max(1L, number());
+        else if (arg == "--warmup")
+            warmup = max(0L, number());
+        else if (arg == "--max-steps")
+            max_steps = max(1L, number());
+        else if (arg == "--json")
+            json = true;
+        else if (arg == "-o" || arg == "--output")
+        {
+            if (i + 1 >= argc)
+                print_usage("File name expected after " + arg);
+            outputname = argv[++i];
+        }
+        else
+            print_usage("Unknown argument " + arg);
+    }
+
+    vector<size_t> state_counts = quick ? vector<size_t>{2, 8} : vector<size_t>{2, 8, 32};
+    vector<size_t> alphabet_sizes = quick ? vector<size_t>{2, 4} : vector<size_t>{2, 4, 8};
+    vector<size_t> input_lengths = quick ? vector<size_t>{16, 256} : vector<size_t>{16, 256, 4096};
+
+    for (int num_tapes = 1; num_tapes <= 2; ++num_tapes)
+        for (size_t num_states : state_counts)
+            for (size_t alphabet_size : alphabet_sizes)
+            {
+                string name = "synthetic-" + to_string(num_tapes) + "t-" + to_string(num_states) + "q-" + to_string(alphabet_size) + "a";
+                bench_machine(name, synthetic_machine(num_tapes, num_states, alphabet_size), num_states, input_lengths);
+            }
+
+    for (string example : {"palindromes.tm", "doubler.tm", "copier.tm", "simp.tm"})
+    {
+        FILE *f = fopen(example.c_str(), "r");
+        if (!f)
+        {
+            cerr << "WARNING: Example " << example << " not found, skipped\n";
+            continue;
+        }
+        TuringMachine tm = read_tm_from_file(f);
+        bench_machine(example, tm, tm.set_of_states().size(), input_lengths);
+    }
+
+    if (outputname.empty())
+        save_results(cout, json);
+    else
+    {
+        ofstream output(outputname);
+        save_results(output, json);
+    }
+}
@@ -1,5 +1,8 @@
+#include <cstdio>
 #include <string>
+#include <set>
 #include "turing_machine.h"
+#include "tm_convert.h"
 
 using namespace std;
 
@@ -17,20 +20,6 @@ using namespace std;
 // Two-tape: (state, [let1, let2] -> (new_state, [let1, let2], "move1 move2"))
 // One-tape: (state, [let] -> (new_state, [let], "move"))
 
-// Move phases for simulting single two-taped moved
-#define PHASE0_START "Phase0-Start"
-#define PHASE0_INPUT "Phase0-Input"
-#define PHASE0_BACK  "Phase0-Back"
-#define PHASE0_SETUP_MARKS "Phase0-Setup-Marks"
-
-#define PHASE1_FIND_SECOND "Phase1-Find-Second" // (Keeping in extended state letter from second head)
-#define PHASE1_SET_SECOND_MARK "Phase1-Set-Second-Mark" 
-#define PHASE1_BACK "Phase1-Back"
-
-#define PHASE2_FIND_FIRST "Phase2-Find-First" 
-#define PHASE2_SET_FIRST_MARK "Phase2-Set-First-Mark" // Set new letter (add head marker), save what letter is there
-#define PHASE2_BACK "Phase2-Back"
-
 // New State = (Phase x Original_State x Alphabet x Direction)
 
 // F' : (Current_phase x Old_state x Letter to/from head1 x Move for head1), [Letter at head2]
@@ -52,7 +41,7 @@ bool is_wrapped(const string &inp)
     }
     return true;
 }
-inline string wrap (const string &inp)
+string wrap(const string &inp)
 {
     return (inp.size() < 2 || is_wrapped(inp)) ? inp : "(" + inp + ")";
 }
@@ -145,25 +134,14 @@ inline char direction_to_chr(char c)
     return c;
 }
 
-// Converts two-taped Turing Machine to single-taped Turing Machine
-TuringMachine tm_convert(const TuringMachine original_tm)
-{
-    if (original_tm.num_tapes != 2)
-    {
-        cout << "Provided machine is not two-taped!\n";
-        exit(1);
-    }
-
-    const string SIGN = "(-)";
-    const string GUARD = SIGN + SIGN;
-    const string HEAD = "v";
-
-    auto original_tm_work_alphabet_with_blank = original_tm.working_alphabet();
-    original_tm_work_alphabet_with_blank.push_back(BLANK);
-    transitions_t ottm_transitions;
+const string SIGN = "(-)";
+const string GUARD = SIGN + SIGN;
+const string HEAD = "v";
 
-    // Preparing input
-    for (auto orig_letter : original_tm.input_alphabet)
+// Phase 0 - Preparing input (depends on the input alphabet only)
+static void convert_input(transitions_t &ottm_transitions, const vector<string> &input_alphabet)
+{
+    for (auto orig_letter : input_alphabet)
     { 
         auto phase_start =  (PHASE0_START + SIGN + INITIAL_STATE + SIGN + BLANK + SIGN + BLANK);
         append_transitions(ottm_transitions, INITIAL_STATE, orig_letter, 
@@ -173,7 +151,7 @@ TuringMachine tm_convert(const TuringMachine original_tm)
         append_transitions(ottm_transitions, phase_start, orig_letter, 
             phase_input, GUARD, string{HEAD_RIGHT});
 
-        for (auto letter_to_see : original_tm.input_alphabet)
+        for (auto letter_to_see : input_alphabet)
         {
             auto phase_next_input = (PHASE0_INPUT + SIGN + INITIAL_STATE + SIGN + letter_to_see + SIGN + BLANK);
             append_transitions(ottm_transitions, phase_input, letter_to_see,
@@ -195,227 +173,225 @@ TuringMachine tm_convert(const TuringMachine original_tm)
         append_transitions(ottm_transitions, phase_setup_marks, orig_letter + SIGN + BLANK,
            phase_start_work, HEAD + orig_letter + SIGN + HEAD + BLANK, string{HEAD_STAY});
     }
+}
 
-    // Phase 1 - Transition translation
-    // Two-tape: (state, [let1, let2] -> (new_state, [let1, let2], "move1 move2"))
-    for (auto &[k, v] : original_tm.transitions)
-    {
-        // Phase $ State Before $ Letter at head 1 $ Direction (null) 
-        auto state_before = PHASE1_FIND_SECOND + SIGN + k.first + SIGN + k.second[0] + SIGN + BLANK;
-        // Phase $ State Now $ New letter for head 1 $ Direction for 1
-        auto state_after = PHASE1_SET_SECOND_MARK + SIGN + get<0>(v) + SIGN + get<1>(v)[0] + SIGN + direction_to_chr(get<2>(v)[0]);
+// Name of the state translating transitions from (state, letter at head 1)
+static string translation_state(const string &state, const string &letter)
+{
+    return wrap(PHASE1_FIND_SECOND + SIGN + state + SIGN + letter + SIGN + BLANK);
+}
 
-        for (auto letter_on_first : original_tm_work_alphabet_with_blank)
-        {
-            append_transitions(ottm_transitions, state_before, letter_on_first + SIGN + HEAD + k.second[1],
-                state_after, letter_on_first + SIGN + get<1>(v)[1], string{get<2>(v)[1]});
-                
-            append_transitions(ottm_transitions, state_before, HEAD + letter_on_first + SIGN + HEAD + k.second[1],
-                state_after, HEAD + letter_on_first + SIGN + get<1>(v)[1], string{get<2>(v)[1]});
-        }
+// Phase 1 - Transition translation
+// Two-tape: (state, [let1, let2] -> (new_state, [let1, let2], "move1 move2"))
+static void convert_transition(transitions_t &ottm_transitions, const vector<string> &alphabet,
+    const pair<string, vector<string>> &k, const tuple<string, vector<string>, string> &v)
+{
+    // Phase $ State Before $ Letter at head 1 $ Direction (null) 
+    auto state_before = PHASE1_FIND_SECOND + SIGN + k.first + SIGN + k.second[0] + SIGN + BLANK;
+    // Phase $ State Now $ New letter for head 1 $ Direction for 1
+    auto state_after = PHASE1_SET_SECOND_MARK + SIGN + get<0>(v) + SIGN + get<1>(v)[0] + SIGN + direction_to_chr(get<2>(v)[0]);
+
+    for (auto letter_on_first : alphabet)
+    {
+        append_transitions(ottm_transitions, state_before, letter_on_first + SIGN + HEAD + k.second[1],
+            state_after, letter_on_first + SIGN + get<1>(v)[1], string{get<2>(v)[1]});
+            
+        append_transitions(ottm_transitions, state_before, HEAD + letter_on_first + SIGN + HEAD + k.second[1],
+            state_after, HEAD + letter_on_first + SIGN + get<1>(v)[1], string{get<2>(v)[1]});
     }
+}
 
+// Transitions leaving a reachable Phase1/Phase2 state; they depend only on the name of the state
+static void expand_state(transitions_t &ottm_transitions, const vector<string> &alphabet, const string &current_state)
+{
     // Phase 1 - Setting mark of second head
-    for (auto letter_on_first : original_tm_work_alphabet_with_blank)
+    if (current_state.find(PHASE1_SET_SECOND_MARK) != std::string::npos)
     {
-        for (auto letter_on_second : original_tm_work_alphabet_with_blank)
+        auto state_after = "(" + string{PHASE1_BACK} + current_state.substr(23);
+
+        for (auto letter_on_first : alphabet)
         {
-            for (auto &[k, v] : ottm_transitions)
+            for (auto letter_on_second : alphabet)
             {
-                string current_state = get<0>(v);
-                if (current_state.find(PHASE1_SET_SECOND_MARK) != std::string::npos)
-                {
-                    auto state_after = "(" + string{PHASE1_BACK} + current_state.substr(23);
-
-                    append_transitions(ottm_transitions, current_state, letter_on_first + SIGN + letter_on_second,
-                        state_after, letter_on_first + SIGN + HEAD + letter_on_second, string{HEAD_LEFT});
+                append_transitions(ottm_transitions, current_state, letter_on_first + SIGN + letter_on_second,
+                    state_after, letter_on_first + SIGN + HEAD + letter_on_second, string{HEAD_LEFT});
 
-                    append_transitions(ottm_transitions, current_state, HEAD + letter_on_first + SIGN + letter_on_second,
-                        state_after, HEAD + letter_on_first + SIGN + HEAD + letter_on_second, string{HEAD_LEFT});
-                }
+                append_transitions(ottm_transitions, current_state, HEAD + letter_on_first + SIGN + letter_on_second,
+                    state_after, HEAD + letter_on_first + SIGN + HEAD + letter_on_second, string{HEAD_LEFT});
             }
         }
     }
 
     // Phase 1 - Backing
-    for (auto &[k, v] : ottm_transitions)
+    if (current_state.find(PHASE1_BACK) != std::string::npos)
     {
-        string current_state = get<0>(v);
-        
-
-        for (auto letter_on_first : original_tm_work_alphabet_with_blank)
+        for (auto letter_on_first : alphabet)
         {
-            for (auto letter_on_second : original_tm_work_alphabet_with_blank)
+            for (auto letter_on_second : alphabet)
             {
-                
-                if (current_state.find(PHASE1_BACK) != std::string::npos)
-                {
-                    // State does not change until reaching guard.
-                    auto state_after = current_state;
-                    auto cell_at_head = letter_on_first + SIGN + letter_on_second;
-
-                    append_transitions(ottm_transitions, current_state, cell_at_head,
-                        state_after, cell_at_head, string{HEAD_LEFT});
-
-                    append_transitions(ottm_transitions, current_state, HEAD + cell_at_head,
-                        state_after, HEAD + cell_at_head, string{HEAD_LEFT});
-                }
+                // State does not change until reaching guard.
+                auto state_after = current_state;
+                auto cell_at_head = letter_on_first + SIGN + letter_on_second;
+
+                append_transitions(ottm_transitions, current_state, cell_at_head,
+                    state_after, cell_at_head, string{HEAD_LEFT});
+
+                append_transitions(ottm_transitions, current_state, HEAD + cell_at_head,
+                    state_after, HEAD + cell_at_head, string{HEAD_LEFT});
             }
         }
 
-        if (current_state.find(PHASE1_BACK) != std::string::npos) 
-        {
-            auto state_find_head1 = "(" + string{PHASE2_FIND_FIRST} + current_state.substr(12);
-            append_transitions(ottm_transitions, current_state, GUARD, 
-                 state_find_head1, GUARD, string{HEAD_RIGHT});
-        }
+        auto state_find_head1 = "(" + string{PHASE2_FIND_FIRST} + current_state.substr(12);
+        append_transitions(ottm_transitions, current_state, GUARD, 
+             state_find_head1, GUARD, string{HEAD_RIGHT});
     }
 
     // Phase 2 - Find first head 
-    for (auto &[k, v] : ottm_transitions)
+    if (current_state.find(PHASE2_FIND_FIRST) != std::string::npos)
     {
-        string current_state = get<0>(v);
-        
-
-        for (auto letter_on_first : original_tm_work_alphabet_with_blank)
+        for (auto letter_on_first : alphabet)
         {
-            for (auto letter_on_second : original_tm_work_alphabet_with_blank)
+            for (auto letter_on_second : alphabet)
             {
-                
-                if (current_state.find(PHASE2_FIND_FIRST) != std::string::npos)
-                {
-                    
-                    auto state_after = current_state;
-                    auto cell_at_head = letter_on_first + SIGN + letter_on_second;
-                    auto cell_at_head_second_head = letter_on_first + SIGN + HEAD + letter_on_second;
-
-                    // Does not see head -> move next
-                    append_transitions(ottm_transitions, current_state, cell_at_head,
-                        state_after, cell_at_head, string{HEAD_RIGHT});
-                    append_transitions(ottm_transitions, current_state, cell_at_head_second_head,
-                        state_after, cell_at_head_second_head, string{HEAD_RIGHT});
-
-                    // Sees head (at first) -> next phase (overwrite letter)
-                    state_after = wrap(string{PHASE2_SET_FIRST_MARK} + SIGN + get_state(current_state) + SIGN + BLANK + SIGN + BLANK);
-                    char new_direction = direction_from_chr(current_state[current_state.size() - 2]);
-                    string new_letter = get_letter(current_state) + SIGN + letter_on_second;
-                    append_transitions(ottm_transitions, current_state, HEAD + cell_at_head,
-                        state_after, new_letter, string{new_direction});
-
-                    string new_letter_head_at_second = get_letter(current_state) + SIGN + HEAD + letter_on_second;
-                    append_transitions(ottm_transitions, current_state, HEAD + cell_at_head_second_head,
-                        state_after, new_letter_head_at_second, string{new_direction});
-                }
+                auto state_after = current_state;
+                auto cell_at_head = letter_on_first + SIGN + letter_on_second;
+                auto cell_at_head_second_head = letter_on_first + SIGN + HEAD + letter_on_second;
+
+                // Does not see head -> move next
+                append_transitions(ottm_transitions, current_state, cell_at_head,
+                    state_after, cell_at_head, string{HEAD_RIGHT});
+                append_transitions(ottm_transitions, current_state, cell_at_head_second_head,
+                    state_after, cell_at_head_second_head, string{HEAD_RIGHT});
+
+                // Sees head (at first) -> next phase (overwrite letter)
+                state_after = wrap(string{PHASE2_SET_FIRST_MARK} + SIGN + get_state(current_state) + SIGN + BLANK + SIGN + BLANK);
+                char new_direction = direction_from_chr(current_state[current_state.size() - 2]);
+                string new_letter = get_letter(current_state) + SIGN + letter_on_second;
+                append_transitions(ottm_transitions, current_state, HEAD + cell_at_head,
+                    state_after, new_letter, string{new_direction});
+
+                string new_letter_head_at_second = get_letter(current_state) + SIGN + HEAD + letter_on_second;
+                append_transitions(ottm_transitions, current_state, HEAD + cell_at_head_second_head,
+                    state_after, new_letter_head_at_second, string{new_direction});
             }
         }
     }
 
     // Phase 2 - Mark first head (and remember its value)
-    for (auto &[k, v] : ottm_transitions)
+    if (current_state.find(PHASE2_SET_FIRST_MARK) != std::string::npos)
     {
-        string current_state = get<0>(v);
-        
-        for (auto letter_on_first : original_tm_work_alphabet_with_blank)
+        for (auto letter_on_first : alphabet)
         {
-            for (auto letter_on_second : original_tm_work_alphabet_with_blank)
+            for (auto letter_on_second : alphabet)
             {
-                if (current_state.find(PHASE2_SET_FIRST_MARK) != std::string::npos)
-                {
-                    auto cell_at_head = letter_on_first + SIGN + letter_on_second;
-                    auto cell_at_head_second_head = letter_on_first + SIGN + HEAD + letter_on_second;
-                    auto state_after = wrap(string{PHASE2_BACK} + SIGN + get_state(current_state) + SIGN + letter_on_first + SIGN + BLANK);
-
-                    append_transitions(ottm_transitions, current_state, cell_at_head,
-                        state_after, HEAD + cell_at_head, string{HEAD_LEFT});
-
-                    append_transitions(ottm_transitions, current_state, cell_at_head_second_head,
-                        state_after, HEAD + cell_at_head_second_head, string{HEAD_LEFT});
-                }
+                auto cell_at_head = letter_on_first + SIGN + letter_on_second;
+                auto cell_at_head_second_head = letter_on_first + SIGN + HEAD + letter_on_second;
+                auto state_after = wrap(string{PHASE2_BACK} + SIGN + get_state(current_state) + SIGN + letter_on_first + SIGN + BLANK);
+
+                append_transitions(ottm_transitions, current_state, cell_at_head,
+                    state_after, HEAD + cell_at_head, string{HEAD_LEFT});
+
+                append_transitions(ottm_transitions, current_state, cell_at_head_second_head,
+                    state_after, HEAD + cell_at_head_second_head, string{HEAD_LEFT});
             }
         }
     }
 
-
     // Phase 2 - Backing 
-    for (auto &[k, v] : ottm_transitions)
+    if (current_state.find(PHASE2_BACK) != std::string::npos)
     {
-        string current_state = get<0>(v);
-        
-
-        for (auto letter_on_first : original_tm_work_alphabet_with_blank)
+        for (auto letter_on_first : alphabet)
         {
-            for (auto letter_on_second : original_tm_work_alphabet_with_blank)
+            for (auto letter_on_second : alphabet)
             {
-                
-                if (current_state.find(PHASE2_BACK) != std::string::npos)
-                {
-                    // State does not change until reaching guard.
-                    auto state_after = current_state;
-                    auto cell_at_head = letter_on_first + SIGN + letter_on_second;
-                    auto cell_at_head_second_head = letter_on_first + SIGN + HEAD + letter_on_second;
-
-                    append_transitions(ottm_transitions, current_state, cell_at_head,
-                        state_after, cell_at_head, string{HEAD_LEFT});
-
-                    append_transitions(ottm_transitions, current_state, cell_at_head_second_head,
-                        state_after, cell_at_head_second_head, string{HEAD_LEFT});
-                }
+                // State does not change until reaching guard.
+                auto state_after = current_state;
+                auto cell_at_head = letter_on_first + SIGN + letter_on_second;
+                auto cell_at_head_second_head = letter_on_first + SIGN + HEAD + letter_on_second;
+
+                append_transitions(ottm_transitions, current_state, cell_at_head,
+                    state_after, cell_at_head, string{HEAD_LEFT});
+
+                append_transitions(ottm_transitions, current_state, cell_at_head_second_head,
+                    state_after, cell_at_head_second_head, string{HEAD_LEFT});
             }
         }
 
-        if (current_state.find(PHASE2_BACK) != std::string::npos) 
-        {
-            auto state_find_head2 = "(" + string{PHASE1_FIND_SECOND} + current_state.substr(12);
-            append_transitions(ottm_transitions, current_state, GUARD, 
-                 state_find_head2, GUARD, string{HEAD_RIGHT});
-        }
+        auto state_find_head2 = "(" + string{PHASE1_FIND_SECOND} + current_state.substr(12);
+        append_transitions(ottm_transitions, current_state, GUARD, 
+             state_find_head2, GUARD, string{HEAD_RIGHT});
     }
 
-
     // Phase 1 - Find second head (keeping in memory first's value)
-    for (auto &[k, v] : ottm_transitions)
+    if (current_state.find(PHASE1_FIND_SECOND) != std::string::npos)
     {
-        string current_state = get<0>(v);
-        
-        for (auto letter_on_first : original_tm_work_alphabet_with_blank)
+        for (auto letter_on_first : alphabet)
         {
-            for (auto letter_on_second : original_tm_work_alphabet_with_blank)
+            for (auto letter_on_second : alphabet)
             {
-                
-                if (current_state.find(PHASE1_FIND_SECOND) != std::string::npos)
-                {
-                    
-                    auto state_after = current_state;
-                    auto cell_at_head = letter_on_first + SIGN + letter_on_second;
-                    auto cell_at_head_first_head = HEAD + letter_on_first + SIGN + letter_on_second;
-
-                    // Does not see head at second head -> move next
-                    append_transitions(ottm_transitions, current_state, cell_at_head,
-                        state_after, cell_at_head, string{HEAD_RIGHT});
-                    append_transitions(ottm_transitions, current_state, cell_at_head_first_head,
-                        state_after, cell_at_head_first_head, string{HEAD_RIGHT});
-
-                    // Sees head (at first) -> next phase (overwrite letter)
-                    // Already introduced in first step = loop completed.
-                }
+                auto state_after = current_state;
+                auto cell_at_head = letter_on_first + SIGN + letter_on_second;
+                auto cell_at_head_first_head = HEAD + letter_on_first + SIGN + letter_on_second;
+
+                // Does not see head at second head -> move next
+                append_transitions(ottm_transitions, current_state, cell_at_head,
+                    state_after, cell_at_head, string{HEAD_RIGHT});
+                append_transitions(ottm_transitions, current_state, cell_at_head_first_head,
+                    state_after, cell_at_head_first_head, string{HEAD_RIGHT});
+
+                // Sees head (at first) -> next phase (overwrite letter)
+                // Already introduced in first step = loop completed.
             }
         }
     }
+}
 
+inline bool is_derived_state(const string &state)
+{
+    return state.find("Phase1") != std::string::npos || state.find("Phase2") != std::string::npos;
+}
 
-    // Extending Blanks
-    for (auto &[k, v] : ottm_transitions)
+// Generates all transitions leaving a Phase1/Phase2 state
+static DerivedState generate_state(const TuringMachine &original_tm, const vector<string> &alphabet,
+    const map<string, pair<string, string>> &translations, const string &state, bool referenced)
+{
+    DerivedState derived;
+    derived.referenced = referenced;
+
+    auto origin = translations.find(state);
+    if (origin != translations.end())
     {
-        if (k.first.substr(1, 6) == "Phase1" || k.first.substr(1, 6) == "Phase2")
+        auto &[orig_state, orig_letter] = origin->second;
+        for (auto it = original_tm.transitions().lower_bound(make_pair(orig_state, vector<string>{orig_letter}));
+             it != original_tm.transitions().end() && it->first.first == orig_state && it->first.second[0] == orig_letter; ++it)
         {
-            append_transitions(ottm_transitions, k.first, BLANK, 
-                    k.first, BLANK + SIGN + BLANK, string{HEAD_STAY});
+            convert_transition(derived.transitions, alphabet, it->first, it->second);
         }
     }
-    
-    // Empty input corner case
+
+    if (referenced)
+        expand_state(derived.transitions, alphabet, state);
+
+    // Extending Blanks
+    if (!derived.transitions.empty() && (state.substr(1, 6) == "Phase1" || state.substr(1, 6) == "Phase2"))
+    {
+        append_transitions(derived.transitions, state, BLANK, 
+                state, BLANK + SIGN + BLANK, string{HEAD_STAY});
+    }
+
+    for (auto &[k, v] : derived.transitions)
+    {
+        if (get<0>(v) != state)
+            derived.successors.insert(get<0>(v));
+    }
+    return derived;
+}
+
+// Empty input corner case
+static void convert_empty_input(transitions_t &ottm_transitions, const TuringMachine &original_tm)
+{
     const vector<string> EMPTY_CELLS = {BLANK, BLANK};
-    if (original_tm.transitions.find(make_pair(INITIAL_STATE, EMPTY_CELLS)) != original_tm.transitions.end())
+    if (original_tm.transitions().find(make_pair(INITIAL_STATE, EMPTY_CELLS)) != original_tm.transitions().end())
     {
         auto transitions_corner_state = INITIAL_STATE + SIGN + INITIAL_STATE + SIGN + BLANK + SIGN + BLANK;
         append_transitions(ottm_transitions, INITIAL_STATE, BLANK,
@@ -425,36 +401,332 @@ TuringMachine tm_convert(const TuringMachine original_tm)
             append_transitions(ottm_transitions, transitions_corner_state, BLANK,
                 new_state, HEAD + BLANK + SIGN + HEAD + BLANK, string{HEAD_STAY});
     }
+}
 
-    // Accept translation
-    for (auto &[k, v] : ottm_transitions)
+inline bool is_accepting_state(const string &state)
+{
+    return state != ACCEPTING_STATE && state.find(SIGN + ACCEPTING_STATE + SIGN) != std::string::npos;
+}
+
+// Accept translation
+static void translate_accept(transitions_t &ottm_transitions, const vector<string> &alphabet, const string &current_state)
+{
+    // Reaching accepting state concludes programme - if head does not fall from the tape.
+    if (is_accepting_state(current_state))
     {
-        auto current_state = get<0>(v);
-        // Reaching accepting state concludes programme - if head does not fall from the tape.
-        if (current_state != ACCEPTING_STATE && current_state.find(SIGN + ACCEPTING_STATE + SIGN) != std::string::npos)
+        append_transitions(ottm_transitions, current_state, BLANK, ACCEPTING_STATE, BLANK, string{HEAD_STAY});
+        
+        for (auto letter_on_first : alphabet)
         {
-            append_transitions(ottm_transitions, current_state, BLANK, ACCEPTING_STATE, BLANK, string{HEAD_STAY});
-            
-            for (auto letter_on_first : original_tm_work_alphabet_with_blank)
+            for (auto letter_on_second : alphabet)
             {
-                for (auto letter_on_second : original_tm_work_alphabet_with_blank)
-                {
-                    auto cell_at_head = letter_on_first + SIGN + letter_on_second;
-                    auto cell_at_head_second_head = letter_on_first + SIGN + HEAD + letter_on_second;
-
-                    // Move to the accept state
-                    append_transitions(ottm_transitions, current_state, cell_at_head,
-                        ACCEPTING_STATE, cell_at_head, string{HEAD_STAY});
-                    append_transitions(ottm_transitions, current_state, cell_at_head_second_head,
-                        ACCEPTING_STATE, cell_at_head_second_head, string{HEAD_STAY});
-                    append_transitions(ottm_transitions, current_state, HEAD + cell_at_head,
-                        ACCEPTING_STATE, HEAD + cell_at_head, string{HEAD_STAY});
-                    append_transitions(ottm_transitions, current_state, HEAD + cell_at_head_second_head,
-                        ACCEPTING_STATE, HEAD + cell_at_head_second_head, string{HEAD_STAY});
-                }
+                auto cell_at_head = letter_on_first + SIGN + letter_on_second;
+                auto cell_at_head_second_head = letter_on_first + SIGN + HEAD + letter_on_second;
+
+                // Move to the accept state
+                append_transitions(ottm_transitions, current_state, cell_at_head,
+                    ACCEPTING_STATE, cell_at_head, string{HEAD_STAY});
+                append_transitions(ottm_transitions, current_state, cell_at_head_second_head,
+                    ACCEPTING_STATE, cell_at_head_second_head, string{HEAD_STAY});
+                append_transitions(ottm_transitions, current_state, HEAD + cell_at_head,
+                    ACCEPTING_STATE, HEAD + cell_at_head, string{HEAD_STAY});
+                append_transitions(ottm_transitions, current_state, HEAD + cell_at_head_second_head,
+                    ACCEPTING_STATE, HEAD + cell_at_head_second_head, string{HEAD_STAY});
             }
         }
     }
+}
+
+// Converts two-taped Turing Machine to single-taped Turing Machine,
+// reusing the states of the previous conversion which are not affected by changed transitions
+TuringMachine tm_convert_incremental(const TuringMachine &original_tm, ConversionRecord &record)
+{
+    if (original_tm.num_tapes != 2)
+    {
+        cout << "Provided machine is not two-taped!\n";
+        exit(1);
+    }
+
+    auto original_tm_work_alphabet_with_blank = original_tm.working_alphabet();
+    original_tm_work_alphabet_with_blank.push_back(BLANK);
+    transitions_t ottm_transitions;
+
+    // Derived states depend on the original transitions only through translation states,
+    // other changes (of alphabets) require full conversion.
+    if (record.input_alphabet != original_tm.input_alphabet() || record.alphabet != original_tm_work_alphabet_with_blank)
+    {
+        record.states.clear();
+        record.source.clear();
+    }
+
+    map<string, pair<string, string>> translations;
+    for (auto &[k, v] : original_tm.transitions())
+        translations[translation_state(k.first, k.second[0])] = make_pair(k.first, k.second[0]);
+
+    set<string> dirty;
+    auto old_it = record.source.begin();
+    auto new_it = original_tm.transitions().begin();
+    while (old_it != record.source.end() || new_it != original_tm.transitions().end())
+    {
+        if (new_it == original_tm.transitions().end() || (old_it != record.source.end() && old_it->first < new_it->first))
+        {
+            dirty.insert(translation_state(old_it->first.first, old_it->first.second[0]));
+            ++old_it;
+        }
+        else if (old_it == record.source.end() || new_it->first < old_it->first)
+        {
+            dirty.insert(translation_state(new_it->first.first, new_it->first.second[0]));
+            ++new_it;
+        }
+        else
+        {
+            if (old_it->second != new_it->second)
+                dirty.insert(translation_state(new_it->first.first, new_it->first.second[0]));
+            ++old_it;
+            ++new_it;
+        }
+    }
+
+    auto is_cached = [&](const string &state, bool referenced) {
+        auto cached = record.states.find(state);
+        return cached != record.states.end() && cached->second.referenced == referenced && dirty.find(state) == dirty.end();
+    };
+
+    // Derived states reachable from the input phase or from translated transitions
+    map<string, DerivedState> generated;
+    auto successors = [&](const string &state) -> const set<string> & {
+        auto fresh = generated.find(state);
+        if (fresh != generated.end())
+            return fresh->second.successors;
+        auto cached = record.states.find(state);
+        if (cached != record.states.end() && dirty.find(state) == dirty.end())
+            return cached->second.successors;
+        auto &derived = generated[state] = generate_state(original_tm, original_tm_work_alphabet_with_blank, translations, state, true);
+        return derived.successors;
+    };
+
+    convert_input(ottm_transitions, original_tm.input_alphabet());
+    vector<string> pending;
+    for (auto &[k, v] : ottm_transitions)
+        pending.push_back(get<0>(v));
+    for (auto &[state, origin] : translations)
+        for (auto &next : successors(state))
+            pending.push_back(next);
+
+    set<string> referenced;
+    while (!pending.empty())
+    {
+        string state = pending.back();
+        pending.pop_back();
+        if (!is_derived_state(state) || !referenced.insert(state).second)
+            continue;
+        for (auto &next : successors(state))
+            pending.push_back(next);
+    }
+
+    // Garbage collecting states which are not referenced anymore
+    map<string, DerivedState> states;
+    record.regenerated_states = 0;
+    auto collect = [&](const string &state) {
+        bool is_referenced = referenced.find(state) != referenced.end();
+        auto fresh = generated.find(state);
+        if (is_cached(state, is_referenced))
+        {
+            states[state] = std::move(record.states[state]);
+            return;
+        }
+        if (fresh != generated.end() && fresh->second.referenced == is_referenced)
+            states[state] = std::move(fresh->second);
+        else
+            states[state] = generate_state(original_tm, original_tm_work_alphabet_with_blank, translations, state, is_referenced);
+        ++record.regenerated_states;
+    };
+    for (auto &[state, origin] : translations)
+        collect(state);
+    for (auto &state : referenced)
+        if (states.find(state) == states.end())
+            collect(state);
+
+    // Transitions come in order, mostly right after the previously inserted one
+    auto hint = ottm_transitions.begin();
+    for (auto &[state, derived] : states)
+        for (auto &transition : derived.transitions)
+            hint = next(ottm_transitions.insert(hint, transition));
+    
+    convert_empty_input(ottm_transitions, original_tm);
+
+    // Accept translation
+    set<string> accepting;
+    for (auto &[k, v] : ottm_transitions)
+        if (is_accepting_state(get<0>(v)))
+            accepting.insert(get<0>(v));
+    for (auto &state : accepting)
+        translate_accept(ottm_transitions, original_tm_work_alphabet_with_blank, state);
+
+    record.input_alphabet = original_tm.input_alphabet();
+    record.alphabet = original_tm_work_alphabet_with_blank;
+    record.source = original_tm.transitions();
+    record.states = std::move(states);
+
+    return TuringMachine(1, original_tm.input_alphabet(), std::move(ottm_transitions));
+}
+
+// Converts two-taped Turing Machine to single-taped Turing Machine
+TuringMachine tm_convert(const TuringMachine original_tm)
+{
+    ConversionRecord record;
+    return tm_convert_incremental(original_tm, record);
+}
+
+// Converts transitions lazily - leaving the input phase converted upfront,
+// other states are generated as generate_state does for referenced states
+LazyConverter::LazyConverter(const TuringMachine &original_tm)
+    : original(original_tm), converted(1, original_tm.input_alphabet(), transitions_t())
+{
+    if (original_tm.num_tapes != 2)
+    {
+        cout << "Provided machine is not two-taped!\n";
+        exit(1);
+    }
+    alphabet = original_tm.working_alphabet();
+    alphabet.push_back(BLANK);
+    for (auto &[k, v] : original_tm.transitions())
+        translations[translation_state(k.first, k.second[0])] = make_pair(k.first, k.second[0]);
+
+    transitions_t input_phase;
+    convert_input(input_phase, original_tm.input_alphabet());
+    convert_empty_input(input_phase, original_tm);
+    converted.add_transitions(input_phase);
+}
+
+transitions_t LazyConverter::transitions_from(const string &state) const
+{
+    transitions_t transitions;
+    if (is_accepting_state(state))
+        translate_accept(transitions, alphabet, state);
+    else if (is_derived_state(state))
+        transitions = generate_state(original, alphabet, translations, state, true).transitions;
+    return transitions;
+}
+
+bool LazyConverter::expand(const string &state)
+{
+    if (!expanded.insert(state).second)
+        return false;
+    return converted.add_transitions(transitions_from(state)) != 0;
+}
+
+static void save_words(ostream &output, const string &header, const vector<string> &words)
+{
+    output << header << ": " << words.size();
+    for (auto &word : words)
+        output << " " << word;
+    output << "\n";
+}
+
+static bool read_words(istream &input, const string &header, vector<string> &words)
+{
+    string word;
+    size_t count;
+    if (!(input >> word) || word != header + ":" || !(input >> count))
+        return false;
+    words.resize(count);
+    for (auto &w : words)
+        if (!(input >> w))
+            return false;
+    return true;
+}
+
+// Lines of derived states leave out the state, which is given once before them:
+// "<state> <referenced> <count>", then "<letter> <new state> <new letter> <move>"
+void save_conversion_record(ostream &output, const ConversionRecord &record, uint64_t checksum)
+{
+    output << "checksum: " << hex << checksum << dec << "\n";
+    save_words(output, "input-alphabet", record.input_alphabet);
+    save_words(output, "alphabet", record.alphabet);
+
+    size_t num_tapes = record.source.empty() ? 0 : record.source.begin()->first.second.size();
+    output << "source: " << num_tapes << " " << record.source.size() << "\n";
+    for (auto &[k, v] : record.source)
+    {
+        output << k.first;
+        for (auto &letter : k.second)
+            output << " " << letter;
+        output << " " << get<0>(v);
+        for (auto &letter : get<1>(v))
+            output << " " << letter;
+        for (char move : get<2>(v))
+            output << " " << move;
+        output << "\n";
+    }
+
+    output << "states: " << record.states.size() << "\n";
+    for (auto &[state, derived] : record.states)
+    {
+        output << state << " " << derived.referenced << " " << derived.transitions.size() << "\n";
+        for (auto &[k, v] : derived.transitions)
+            output << k.second[0] << " " << get<0>(v) << " " << get<1>(v)[0] << " " << get<2>(v) << "\n";
+    }
+}
+
+bool read_conversion_record(istream &input, uint64_t checksum, ConversionRecord &record)
+{
+    string word;
+    uint64_t saved;
+    if (!(input >> word) || word != "checksum:" || !(input >> hex >> saved >> dec) || saved != checksum)
+        return false;
+    if (!read_words(input, "input-alphabet", record.input_alphabet) || !read_words(input, "alphabet", record.alphabet))
+        return false;
+
+    size_t num_tapes, count;
+    if (!(input >> word) || word != "source:" || !(input >> num_tapes >> count))
+        return false;
+    for (size_t i = 0; i < count; ++i)
+    {
+        transitions_t::key_type k;
+        transitions_t::mapped_type v;
+        k.second.resize(num_tapes);
+        get<1>(v).resize(num_tapes);
+        if (!(input >> k.first))
+            return false;
+        for (auto &letter : k.second)
+            if (!(input >> letter))
+                return false;
+        if (!(input >> get<0>(v)))
+            return false;
+        for (auto &letter : get<1>(v))
+            if (!(input >> letter))
+                return false;
+        for (size_t a = 0; a < num_tapes; ++a)
+        {
+            char move;
+            if (!(input >> move))
+                return false;
+            get<2>(v) += move;
+        }
+        record.source.emplace_hint(record.source.end(), std::move(k), std::move(v));
+    }
 
-    return TuringMachine(1, original_tm.input_alphabet, ottm_transitions);
+    if (!(input >> word) || word != "states:" || !(input >> count))
+        return false;
+    for (size_t i = 0; i < count; ++i)
+    {
+        string state;
+        size_t transitions;
+        DerivedState derived;
+        if (!(input >> state >> derived.referenced >> transitions))
+            return false;
+        for (size_t j = 0; j < transitions; ++j)
+        {
+            string letter, new_state, new_letter, move;
+            if (!(input >> letter >> new_state >> new_letter >> move))
+                return false;
+            if (new_state != state)
+                derived.successors.insert(new_state);
+            derived.transitions.emplace_hint(derived.transitions.end(), make_pair(state, vector<string>{std::move(letter)}),
+                make_tuple(std::move(new_state), vector<string>{std::move(new_letter)}, std::move(move)));
+        }
+        record.states.emplace_hint(record.states.end(), std::move(state), std::move(derived));
+    }
+    return true;
 }
@@ -1,9 +1,88 @@
-
 #ifndef __TM_CONVERT_H
 #define __TM_CONVERT_H 
 
+#include <cstdint>
+#include <cstdio>
+#include <istream>
+#include <map>
+#include <ostream>
+#include <set>
+#include <string>
+#include <vector>
 #include "turing_machine.h"
 
+// Move phases for simulting single two-taped moved
+#define PHASE0_START "Phase0-Start"
+#define PHASE0_INPUT "Phase0-Input"
+#define PHASE0_BACK  "Phase0-Back"
+#define PHASE0_SETUP_MARKS "Phase0-Setup-Marks"
+
+#define PHASE1_FIND_SECOND "Phase1-Find-Second" // (Keeping in extended state letter from second head)
+#define PHASE1_SET_SECOND_MARK "Phase1-Set-Second-Mark" 
+#define PHASE1_BACK "Phase1-Back"
+
+#define PHASE2_FIND_FIRST "Phase2-Find-First" 
+#define PHASE2_SET_FIRST_MARK "Phase2-Set-First-Mark" // Set new letter (add head marker), save what letter is there
+#define PHASE2_BACK "Phase2-Back"
+
+// Transitions of the one-taped machine leaving a single Phase1/Phase2 state
+struct DerivedState
+{
+    transitions_t transitions;
+    std::set<std::string> successors; // states entered from this one (except itself)
+    bool referenced = false; // reachable, not only translating original transitions
+};
+
+// Result of the previous conversion, used for incremental re-conversion
+struct ConversionRecord
+{
+    std::vector<std::string> input_alphabet;
+    std::vector<std::string> alphabet; // working alphabet with blank
+    transitions_t source; // transitions of the original machine
+    std::map<std::string, DerivedState> states;
+    size_t regenerated_states = 0; // by the last conversion
+};
+
+// Adds brackets if necessary (names of states and letters of the one-taped machine)
+std::string wrap(const std::string &inp);
+
 TuringMachine tm_convert(TuringMachine original_tm);
 
+// Same result as tm_convert, but regenerates only states derived from changed transitions
+// (record is updated for the next conversion)
+TuringMachine tm_convert_incremental(const TuringMachine &original_tm, ConversionRecord &record);
+
+// Lazy variant of tm_convert: only the input phase is converted upfront, transitions leaving
+// other states are generated when the state is entered for the first time (expand), and kept
+// in machine(). Runs of machine() extended this way are the same as runs of tm_convert result.
+class LazyConverter
+{
+public:
+    LazyConverter(const TuringMachine &original_tm);
+
+    const TuringMachine &machine() const { return converted; }
+    // Generates transitions leaving the state; false if it was already done (or there are none)
+    bool expand(const std::string &state);
+    // Same transitions as expand adds, without keeping them (for tables kept elsewhere)
+    transitions_t transitions_from(const std::string &state) const;
+    size_t expanded_states() const { return expanded.size(); }
+
+private:
+    const TuringMachine &original;
+    std::vector<std::string> alphabet; // working alphabet with blank
+    std::map<std::string, std::pair<std::string, std::string>> translations;
+    std::set<std::string> expanded;
+    TuringMachine converted;
+};
+
+// Alternative encoding: every cell of the two-taped machine is a block of binary cells;
+// much smaller alphabet and table, but O(log m) times more steps
+TuringMachine tm_convert_binary(const TuringMachine &original_tm);
+
+// The record is kept next to the translation (tm_translator -i), with a checksum of the output
+// it describes; transitions are saved grouped by state, so loading them needs no validation.
+void save_conversion_record(std::ostream &output, const ConversionRecord &record, uint64_t checksum);
+// Returns false on malformed input or on a record of other output (different checksum)
+bool read_conversion_record(std::istream &input, uint64_t checksum, ConversionRecord &record);
+
 #endif
@@ -0,0 +1,381 @@
+#include <map>
+#include <string>
+#include <vector>
+#include "turing_machine.h"
+#include "tm_convert.h"
+
+using namespace std;
+
+// Translation from two-taped Turing Machine to single-taped Turing Machine with binary encoded tracks.
+// Each cell of the two-taped machine is a block of B = 2b + 2 cells over {0, 1}:
+//   [mark of head 1] [letter on tape 1 - b bits] [mark of head 2] [letter on tape 2 - b bits]
+// where b = ceil(log2 m) for working alphabet of size m. Blank is encoded as zeros,
+// so blanks behind the end of the tape are read as zero bits.
+// Alphabet size O(1) (apart from input letters), transitions O(|Q| m (m + b)),
+// but each step of the original machine takes O(n B) steps (instead of O(n)).
+
+// The input a1 ... an is encoded behind itself:  J ... J G [a1] ... [an]
+// (J - processed input letter, G - guard, never passed by the simulation)
+#define BIN_CARRY "Bin0-Carry"
+#define BIN_WRITE_BLOCK "Bin0-Write-Block"
+#define BIN_RETURN "Bin0-Return"
+#define BIN_TAKE "Bin0-Take"
+
+#define BIN_FIND_SECOND "Bin1-Find-Second" // Finding mark of head 2 (keeping state and letter from head 1)
+#define BIN_DECODE_SECOND "Bin1-Decode-Second" // Reading letter from head 2 bit by bit
+#define BIN_WRITE_SECOND "Bin1-Write-Second"
+#define BIN_MOVE_SECOND "Bin1-Move-Second"
+#define BIN_BACK "Bin1-Back"
+
+#define BIN_FIND_FIRST "Bin2-Find-First"
+#define BIN_WRITE_FIRST "Bin2-Write-First"
+#define BIN_MOVE_FIRST "Bin2-Move-First"
+#define BIN_DECODE_FIRST "Bin2-Decode-First"
+#define BIN_BACK_TO_GUARD "Bin2-Back"
+
+static const string SIGN = "(-)";
+static const string BIT[2] = {"(-0)", "(-1)"};
+static const string GUARD = "((-)(-))";
+static const string JUNK = "(-J)";
+
+class BinaryConverter
+{
+public:
+    BinaryConverter(const TuringMachine &original_tm_) : original_tm(original_tm_)
+    {
+        letters.push_back(BLANK);
+        for (auto &letter : original_tm.working_alphabet())
+            if (letter != BLANK)
+                letters.push_back(letter);
+        for (size_t a = 0; a < letters.size(); ++a)
+            letter_index[letters[a]] = a;
+        bits = 1;
+        while ((1u << bits) < letters.size())
+            ++bits;
+        block = 2 * bits + 2;
+    }
+
+    TuringMachine convert()
+    {
+        convert_input();
+        while (!pending.empty())
+        {
+            auto [orig_state, letter] = pending.back();
+            pending.pop_back();
+            find_second(orig_state, letter);
+        }
+        return TuringMachine(1, original_tm.input_alphabet(), std::move(transitions));
+    }
+
+private:
+    const TuringMachine &original_tm;
+    vector<string> letters; // blank first
+    map<string, size_t> letter_index;
+    size_t bits, block;
+    transitions_t transitions;
+    map<string, bool> generated; // states with generated transitions
+    vector<pair<string, string>> pending; // (state, letter under head 1) to be simulated
+
+    static string state(const vector<string> &parts)
+    {
+        string res = "(";
+        for (size_t a = 0; a < parts.size(); ++a)
+            res += (a ? SIGN : "") + parts[a];
+        return res + ")";
+    }
+
+    static string number(size_t value)
+    {
+        return "(" + to_string(value) + ")";
+    }
+
+    static string direction(char dir)
+    {
+        return dir == HEAD_LEFT ? "L" : dir == HEAD_RIGHT ? "R" : "S";
+    }
+
+    // Returns false if transitions from the state were already generated
+    bool generate(const string &state_name)
+    {
+        return generated.emplace(state_name, true).second;
+    }
+
+    void add(const string &from_state, const string &letter, const string &new_state, const string &new_letter, char dir)
+    {
+        transitions[make_pair(from_state, vector<string>{letter})] = make_tuple(new_state, vector<string>{new_letter}, string{dir});
+    }
+
+    // Cells which can be met inside encoded blocks
+    static vector<string> cells()
+    {
+        return {BIT[0], BIT[1], BLANK};
+    }
+
+    static int bit_of(const string &cell)
+    {
+        return cell == BIT[1] ? 1 : 0;
+    }
+
+    int letter_bit(size_t letter, size_t bit) const
+    {
+        return (letter >> (bits - 1 - bit)) & 1;
+    }
+
+    // Cell at offset pos of the block encoding (letter, blank) with both marks set or not
+    string block_cell(size_t letter, bool marks, size_t pos) const
+    {
+        if (pos == 0 || pos == bits + 1)
+            return BIT[marks];
+        if (pos <= bits)
+            return BIT[letter_bit(letter, pos - 1)];
+        return BIT[0];
+    }
+
+    // Phase 0 - Encoding input
+    void convert_input()
+    {
+        size_t blank = letter_index[BLANK];
+
+        // Empty input - just the block with both heads
+        write_block(blank, true, INITIAL_STATE, BLANK, GUARD, state({BIN_BACK_TO_GUARD, INITIAL_STATE, BLANK}));
+        back_to_guard(INITIAL_STATE, BLANK);
+
+        auto take = state({BIN_TAKE});
+        auto ret = state({BIN_RETURN});
+        for (auto &orig_letter : original_tm.input_alphabet())
+        {
+            size_t letter = letter_index[orig_letter];
+            auto carry_first = state({BIN_CARRY, orig_letter, "F"});
+            auto carry = state({BIN_CARRY, orig_letter});
+            add(INITIAL_STATE, orig_letter, carry_first, JUNK, HEAD_RIGHT);
+            add(take, orig_letter, carry, JUNK, HEAD_RIGHT);
+
+            for (auto &letter_to_see : original_tm.input_alphabet())
+            {
+                add(carry_first, letter_to_see, carry_first, letter_to_see, HEAD_RIGHT);
+                add(carry, letter_to_see, carry, letter_to_see, HEAD_RIGHT);
+            }
+            for (auto &cell : {GUARD, BIT[0], BIT[1]})
+                add(carry, cell, carry, cell, HEAD_RIGHT);
+
+            write_block(letter, true, carry_first, BLANK, GUARD, ret);
+            write_block(letter, false, carry, BLANK, block_cell(letter, false, 0), ret);
+
+            add(ret, orig_letter, ret, orig_letter, HEAD_LEFT);
+        }
+        for (auto &cell : {GUARD, BIT[0], BIT[1]})
+            add(ret, cell, ret, cell, HEAD_LEFT);
+        add(ret, JUNK, take, JUNK, HEAD_RIGHT);
+
+        // All letters are encoded - reading letter under head 1
+        add(take, GUARD, state({BIN_MOVE_FIRST, INITIAL_STATE, "S", number(0)}), GUARD, HEAD_RIGHT);
+        move_first(INITIAL_STATE, HEAD_STAY, 0);
+    }
+
+    // Writes the block (starting with writing first_cell in from_state reading letter), then goes left in next_state
+    void write_block(size_t letter, bool marks, const string &from_state, const string &letter_read,
+        const string &first_cell, const string &next_state)
+    {
+        // first_cell is either the guard (then the whole block follows) or the first cell of the block
+        size_t pos = first_cell == GUARD ? 0 : 1;
+        auto name = [&](size_t p) { return state({BIN_WRITE_BLOCK, letters[letter], marks ? "M" : "N", number(p)}); };
+        add(from_state, letter_read, pos == block ? next_state : name(pos), first_cell, pos == block ? HEAD_LEFT : HEAD_RIGHT);
+        for (; pos < block; ++pos)
+            add(name(pos), BLANK, pos + 1 == block ? next_state : name(pos + 1), block_cell(letter, marks, pos),
+                pos + 1 == block ? HEAD_LEFT : HEAD_RIGHT);
+    }
+
+    // Going left to the guard, then finding head 2 in (orig_state, letter under head 1)
+    void back_to_guard(const string &orig_state, const string &letter)
+    {
+        auto current = state({BIN_BACK_TO_GUARD, orig_state, letter});
+        if (!generate(current))
+            return;
+        for (auto &cell : cells())
+            add(current, cell, current, cell, HEAD_LEFT);
+        add(current, GUARD, state({BIN_FIND_SECOND, orig_state, letter, number(0)}), GUARD, HEAD_RIGHT);
+        pending.emplace_back(orig_state, letter);
+    }
+
+    // Phase 1 - Finding head 2 and executing transition from (orig_state, [letter, ?])
+    void find_second(const string &orig_state, const string &letter)
+    {
+        auto name = [&](size_t pos) { return state({BIN_FIND_SECOND, orig_state, letter, number(pos)}); };
+        if (!generate(name(0)))
+            return;
+        for (size_t pos = 0; pos < block; ++pos)
+        {
+            for (auto &cell : cells())
+            {
+                if (pos == bits + 1 && cell == BIT[1])
+                    add(name(pos), cell, state({BIN_DECODE_SECOND, orig_state, letter, "p"}), BIT[0], HEAD_RIGHT);
+                else
+                    add(name(pos), cell, name((pos + 1) % block), cell, HEAD_RIGHT);
+            }
+        }
+        decode_second(orig_state, letter, "");
+    }
+
+    void decode_second(const string &orig_state, const string &letter, const string &prefix)
+    {
+        auto current = state({BIN_DECODE_SECOND, orig_state, letter, "p" + prefix});
+        for (auto &cell : cells())
+        {
+            string read = prefix + to_string(bit_of(cell));
+            if (read.size() < bits)
+            {
+                add(current, cell, state({BIN_DECODE_SECOND, orig_state, letter, "p" + read}), cell, HEAD_RIGHT);
+                if (cell != BLANK)
+                    decode_second(orig_state, letter, read);
+                continue;
+            }
+
+            size_t second = stoul(read, nullptr, 2);
+            if (second >= letters.size())
+                continue;
+            auto trans = original_tm.transitions().find(make_pair(orig_state, vector<string>{letter, letters[second]}));
+            if (trans == original_tm.transitions().end())
+                continue; // No transition - the machine rejects
+            auto &[new_state, new_letters, directions] = trans->second;
+            if (new_state == REJECTING_STATE)
+            {
+                add(current, cell, new_state, cell, HEAD_STAY);
+                continue;
+            }
+
+            // Writing new letter for head 2 backwards
+            size_t new_second = letter_index[new_letters[1]];
+            vector<string> target{new_state, new_letters[0], direction(directions[0]), direction(directions[1]), new_letters[1]};
+            auto name = [&](size_t pos) {
+                auto parts = target;
+                parts.insert(parts.begin(), BIN_WRITE_SECOND);
+                parts.push_back(number(pos));
+                return state(parts);
+            };
+            size_t moves = directions[1] == HEAD_STAY ? 0 : block;
+            auto move_state = state({BIN_MOVE_SECOND, new_state, new_letters[0], direction(directions[0]), direction(directions[1]), number(moves)});
+            add(current, cell, bits == 1 ? move_state : name(bits - 2), BIT[letter_bit(new_second, bits - 1)], HEAD_LEFT);
+            for (size_t pos = bits - 1; pos-- > 0;)
+            {
+                for (auto &any : cells())
+                    add(name(pos), any, pos == 0 ? move_state : name(pos - 1), BIT[letter_bit(new_second, pos)], HEAD_LEFT);
+            }
+            move_second(new_state, new_letters[0], directions[0], directions[1], moves);
+        }
+    }
+
+    void move_second(const string &new_state, const string &new_first, char dir_first, char dir, size_t moves)
+    {
+        auto name = [&](size_t k) { return state({BIN_MOVE_SECOND, new_state, new_first, direction(dir_first), direction(dir), number(k)}); };
+        if (!generate(name(moves)))
+            return;
+        for (size_t k = moves; k > 0; --k)
+            for (auto &cell : cells())
+                add(name(k), cell, name(k - 1), cell, dir);
+
+        // Setting mark of head 2, then going back to the guard
+        auto back = state({BIN_BACK, new_state, new_first, direction(dir_first)});
+        for (auto &cell : cells())
+            add(name(0), cell, back, BIT[1], HEAD_LEFT);
+        if (!generate(back))
+            return;
+        for (auto &cell : cells())
+            add(back, cell, back, cell, HEAD_LEFT);
+        add(back, GUARD, state({BIN_FIND_FIRST, new_state, new_first, direction(dir_first), number(0)}), GUARD, HEAD_RIGHT);
+        find_first(new_state, new_first, dir_first);
+    }
+
+    // Phase 2 - Finding head 1, writing its new letter and moving it
+    void find_first(const string &new_state, const string &new_first, char dir)
+    {
+        auto name = [&](size_t pos) { return state({BIN_FIND_FIRST, new_state, new_first, direction(dir), number(pos)}); };
+        auto write_name = [&](size_t pos) { return state({BIN_WRITE_FIRST, new_state, new_first, direction(dir), number(pos)}); };
+        if (!generate(name(0)))
+            return;
+        for (size_t pos = 0; pos < block; ++pos)
+        {
+            for (auto &cell : cells())
+            {
+                if (pos == 0 && cell == BIT[1])
+                    add(name(pos), cell, write_name(0), BIT[0], HEAD_RIGHT);
+                else
+                    add(name(pos), cell, name((pos + 1) % block), cell, HEAD_RIGHT);
+            }
+        }
+
+        // After writing the letter the head is at the mark of head 2 of the same block
+        size_t letter = letter_index[new_first];
+        size_t moves = dir == HEAD_LEFT ? block + bits + 1 : bits + 1;
+        char move_dir = dir == HEAD_RIGHT ? HEAD_RIGHT : HEAD_LEFT;
+        for (size_t pos = 0; pos < bits; ++pos)
+        {
+            auto next = pos + 1 == bits ? state({BIN_MOVE_FIRST, new_state, direction(move_dir), number(moves)}) : write_name(pos + 1);
+            for (auto &cell : cells())
+                add(write_name(pos), cell, next, BIT[letter_bit(letter, pos)], HEAD_RIGHT);
+        }
+        move_first(new_state, move_dir, moves);
+    }
+
+    void move_first(const string &new_state, char dir, size_t moves)
+    {
+        auto name = [&](size_t k) { return state({BIN_MOVE_FIRST, new_state, direction(dir), number(k)}); };
+        if (!generate(name(moves)))
+            return;
+        for (size_t k = moves; k > 0; --k)
+            for (auto &cell : cells())
+                add(name(k), cell, name(k - 1), cell, dir);
+
+        // Both heads moved without falling off the tape
+        if (new_state == ACCEPTING_STATE)
+        {
+            for (auto &cell : cells())
+                add(name(0), cell, ACCEPTING_STATE, cell, HEAD_STAY);
+            return;
+        }
+
+        // Setting mark of head 1 and reading its letter
+        for (auto &cell : cells())
+            add(name(0), cell, state({BIN_DECODE_FIRST, new_state, "p"}), BIT[1], HEAD_RIGHT);
+        decode_first(new_state, "");
+    }
+
+    void decode_first(const string &new_state, const string &prefix)
+    {
+        auto current = state({BIN_DECODE_FIRST, new_state, "p" + prefix});
+        if (!generate(current))
+            return;
+        for (auto &cell : cells())
+        {
+            string read = prefix + to_string(bit_of(cell));
+            if (read.size() < bits)
+            {
+                add(current, cell, state({BIN_DECODE_FIRST, new_state, "p" + read}), cell, HEAD_RIGHT);
+                decode_first(new_state, read);
+                continue;
+            }
+            size_t first = stoul(read, nullptr, 2);
+            if (first >= letters.size())
+                continue;
+            auto trans = original_tm.transitions().lower_bound(make_pair(new_state, vector<string>{letters[first]}));
+            if (trans == original_tm.transitions().end() || trans->first.first != new_state || trans->first.second[0] != letters[first])
+            {
+                // No transition from (new_state, [letter, ?]) - the machine rejects
+                add(current, cell, REJECTING_STATE, cell, HEAD_STAY);
+                continue;
+            }
+            add(current, cell, state({BIN_BACK_TO_GUARD, new_state, letters[first]}), cell, HEAD_LEFT);
+            back_to_guard(new_state, letters[first]);
+        }
+    }
+};
+
+// Converts two-taped Turing Machine to single-taped Turing Machine with binary encoded tracks
+TuringMachine tm_convert_binary(const TuringMachine &original_tm)
+{
+    if (original_tm.num_tapes != 2)
+    {
+        cout << "Provided machine is not two-taped!\n";
+        exit(1);
+    }
+    return BinaryConverter(original_tm).convert();
+}
@@ -0,0 +1,330 @@
+#include <algorithm>
+#include <stdexcept>
+#include "tm_dense.h"
+
+using namespace std;
+
+#define MAX_TABLE_SIZE (1 << 26)
+
+DenseMachine::DenseMachine(const TuringMachine &tm, const Layout *layout) : num_tapes(tm.num_tapes)
+{
+    const vector<string> &alphabet = tm.working_alphabet();
+    letters = {BLANK};
+    if (layout)
+        for (auto &letter : layout->letters)
+            if (binary_search(alphabet.begin(), alphabet.end(), letter) && find(letters.begin(), letters.end(), letter) == letters.end())
+                letters.push_back(letter);
+    for (auto &letter : alphabet)
+        if (find(letters.begin(), letters.end(), letter) == letters.end())
+            letters.push_back(letter);
+    num_letters = letters.size();
+    for (int32_t a = 0; a < num_letters; ++a)
+        letter_ids[letters[a]] = a;
+
+    const vector<string> &names = tm.set_of_states();
+    state_ids = {{ACCEPTING_STATE, DENSE_ACCEPT}, {REJECTING_STATE, DENSE_REJECT}};
+    if (layout)
+        for (auto &state : layout->states)
+            if (binary_search(names.begin(), names.end(), state))
+                state_ids.emplace(state, state_ids.size() + DENSE_RUNNING - 2);
+    for (auto &state : names)
+        state_ids.emplace(state, state_ids.size() + DENSE_RUNNING - 2);
+    initial = state_ids[INITIAL_STATE];
+    states.assign(state_ids.size() + 2, "");
+    states[DENSE_NO_TRANSITION] = REJECTING_STATE;
+    for (auto &[name, id] : state_ids)
+        states[id] = name;
+
+    if (dense_table_size(tm) > MAX_TABLE_SIZE)
+        throw length_error("Machine is too large for the dense transition table");
+    resize_table(num_letters, 0);
+    for (auto &[k, v] : tm.transitions())
+        set_row(k, v);
+}
+
+size_t DenseMachine::add_transitions(const transitions_t &more)
+{
+    int32_t old_letters = num_letters;
+    size_t old_states = states.size();
+    auto add_letters = [&](const vector<string> &names) {
+        for (auto &letter : names)
+            if (letter_ids.emplace(letter, letters.size()).second)
+                letters.push_back(letter);
+    };
+    auto add_state = [&](const string &name) {
+        if (state_ids.emplace(name, states.size()).second)
+            states.push_back(name);
+    };
+    for (auto &[k, v] : more)
+    {
+        add_state(k.first);
+        add_state(get<0>(v));
+        add_letters(k.second);
+        add_letters(get<1>(v));
+    }
+    // Room for twice as many letters, so that the table is laid out anew only a few times
+    if ((int32_t)letters.size() > num_letters)
+        num_letters = max<int32_t>(letters.size(), 2 * num_letters);
+    resize_table(old_letters, old_states);
+
+    size_t added = 0;
+    for (auto &[k, v] : more)
+        added += set_row(k, v);
+    return added;
+}
+
+// Rows of halting states lead to the state itself, other rows to DENSE_NO_TRANSITION;
+// letters under heads are left as they are
+void DenseMachine::init_rows(size_t begin)
+{
+    size_t row = 1;
+    for (int a = 0; a < num_tapes; ++a)
+        row *= num_letters;
+    for (size_t index = begin; index < next_state.size(); ++index)
+    {
+        next_state[index] = index / row < DENSE_RUNNING ? index / row : DENSE_NO_TRANSITION;
+        size_t rest = index;
+        for (int a = num_tapes - 1; a >= 0; --a, rest /= num_letters)
+        {
+            new_letter[a][index] = rest % num_letters;
+            head_move[a][index] = 0;
+        }
+    }
+}
+
+// Makes rows for all states, keeping the rows of the first old_states states
+// (laid out for old_letters letters per row)
+void DenseMachine::resize_table(int32_t old_letters, size_t old_states)
+{
+    size_t row = 1, old_row = 1;
+    for (int a = 0; a < num_tapes; ++a)
+    {
+        if (row > (size_t)MAX_TABLE_SIZE / num_letters)
+            throw length_error("Machine is too large for the dense transition table");
+        row *= num_letters;
+        old_row *= old_letters;
+    }
+    if (row > MAX_TABLE_SIZE / states.size())
+        throw length_error("Machine is too large for the dense transition table");
+    size_t size = row * states.size();
+    new_letter.resize(num_tapes);
+    head_move.resize(num_tapes);
+
+    // New states only - rows are appended
+    if (old_letters == num_letters)
+    {
+        next_state.resize(size);
+        for (int a = 0; a < num_tapes; ++a)
+        {
+            new_letter[a].resize(size);
+            head_move[a].resize(size);
+        }
+        init_rows(old_row * old_states);
+        return;
+    }
+
+    vector<int32_t> old_next = std::move(next_state);
+    vector<vector<int32_t>> old_new_letter = std::move(new_letter), old_head_move = std::move(head_move);
+    next_state.assign(size, 0);
+    new_letter.assign(num_tapes, vector<int32_t>(size));
+    head_move.assign(num_tapes, vector<int32_t>(size));
+    init_rows(0);
+    for (size_t old_index = 0; old_index < old_row * old_states; ++old_index)
+    {
+        size_t index = 0, scale = 1, rest = old_index % old_row;
+        for (int a = num_tapes - 1; a >= 0; --a, rest /= old_letters, scale *= num_letters)
+            index += rest % old_letters * scale;
+        index += old_index / old_row * row;
+        next_state[index] = old_next[old_index];
+        for (int a = 0; a < num_tapes; ++a)
+        {
+            new_letter[a][index] = old_new_letter[a][old_index];
+            head_move[a][index] = old_head_move[a][old_index];
+        }
+    }
+}
+
+bool DenseMachine::set_row(const transitions_t::key_type &k, const transitions_t::mapped_type &v)
+{
+    size_t index = state_ids.at(k.first);
+    for (int a = 0; a < num_tapes; ++a)
+        index = index * num_letters + letter_ids.at(k.second[a]);
+    bool missing = next_state[index] == DENSE_NO_TRANSITION;
+    next_state[index] = state_ids.at(get<0>(v));
+    for (int a = 0; a < num_tapes; ++a)
+    {
+        new_letter[a][index] = letter_ids.at(get<1>(v)[a]);
+        char dir = get<2>(v)[a];
+        head_move[a][index] = dir == HEAD_LEFT ? -1 : dir == HEAD_RIGHT ? 1 : 0;
+    }
+    return missing;
+}
+
+size_t dense_table_size(const TuringMachine &tm)
+{
+    // states of the machine and DENSE_NO_TRANSITION, DENSE_IDLE
+    size_t size = tm.set_of_states().size() + 2, letters = tm.working_alphabet().size();
+    for (int a = 0; a < tm.num_tapes; ++a)
+    {
+        if (size > SIZE_MAX / letters)
+            return SIZE_MAX;
+        size *= letters;
+    }
+    return size;
+}
+
+DenseSimulator::DenseSimulator(const DenseMachine &machine, vector<unique_ptr<Tape>> tapes)
+    : dense(machine), tapes_(std::move(tapes)), heads_(machine.num_tapes)
+{
+    const int k = dense.num_tapes;
+    for (auto &tape : tapes_)
+        raw_tapes.push_back(tape.get());
+    records.resize(dense.next_state.size() * (1 + 2 * k));
+    load_rows(0, dense.next_state.size());
+    loaded_letters = dense.num_letters;
+    bool vector_tapes = all_of(tapes_.begin(), tapes_.end(),
+        [](const unique_ptr<Tape> &tape) { return dynamic_cast<VectorTape *>(tape.get()) != nullptr; });
+    run_loop = vector_tapes ? choose_loop<VectorTape>(k) : choose_loop<Tape>(k);
+    reset({});
+}
+
+SimulatorStatus DenseSimulator::reset(const vector<string> &word)
+{
+    for (auto &tape : tapes_)
+        tape->clear();
+    heads_.assign(dense.num_tapes, 0);
+    state_ = dense.initial;
+    steps_ = 0;
+    status_ = SIM_RUNNING;
+    message_.clear();
+    for (size_t a = 0; a < word.size(); ++a)
+    {
+        auto letter = dense.letter_ids.find(word[a]);
+        if (letter == dense.letter_ids.end())
+        {
+            status_ = SIM_ERROR;
+            message_ = "Input is not a sequence of input letters";
+            break;
+        }
+        tapes_[0]->write(a, letter->second);
+    }
+    return status_;
+}
+
+void DenseSimulator::load_rows(size_t begin, size_t end)
+{
+    const int k = dense.num_tapes;
+    const size_t stride = 1 + 2 * k;
+    for (size_t row = begin; row < end; ++row)
+    {
+        int32_t *record = &records[row * stride];
+        record[0] = dense.next_state[row];
+        for (int a = 0; a < k; ++a)
+        {
+            record[1 + a] = dense.new_letter[a][row];
+            record[1 + k + a] = dense.head_move[a][row];
+        }
+    }
+}
+
+// Same semantics as Simulator::run
+SimulatorStatus DenseSimulator::run(size_t budget)
+{
+    for (;;)
+    {
+        size_t start = steps_;
+        (this->*run_loop)(budget);
+        if (!missing)
+            return status_;
+        // The loop stopped at a row without transition, which the expander may fill
+        missing = false;
+        budget -= steps_ - start;
+        if (!expander(dense.states[state_]))
+        {
+            message_ = "No transition from this configuration";
+            status_ = SIM_REJECT;
+            return status_;
+        }
+        // Rows of the state and of new states, or the whole table if it was laid out anew
+        size_t old_rows = records.size() / (1 + 2 * dense.num_tapes);
+        records.resize(dense.next_state.size() * (1 + 2 * dense.num_tapes));
+        if (dense.num_letters != loaded_letters)
+        {
+            load_rows(0, dense.next_state.size());
+            loaded_letters = dense.num_letters;
+            continue;
+        }
+        size_t row = dense.next_state.size() / dense.states.size();
+        load_rows(state_ * row, (state_ + 1) * row);
+        load_rows(old_rows, dense.next_state.size());
+    }
+}
+
+template<typename TapeType>
+DenseSimulator::RunLoop DenseSimulator::choose_loop(int num_tapes)
+{
+    switch (num_tapes)
+    {
+        case 1: return &DenseSimulator::run_tapes<1, TapeType>;
+        case 2: return &DenseSimulator::run_tapes<2, TapeType>;
+        case 3: return &DenseSimulator::run_tapes<3, TapeType>;
+        default: return &DenseSimulator::run_tapes<0, TapeType>;
+    }
+}
+
+template<int K, typename TapeType>
+SimulatorStatus DenseSimulator::run_tapes(size_t budget)
+{
+    const int k = K ? K : dense.num_tapes;
+    const size_t stride = 1 + 2 * k;
+    const int32_t num_letters = dense.num_letters;
+    Tape *const *tape = raw_tapes.data();
+    size_t *heads = heads_.data();
+
+    for (; budget && status_ == SIM_RUNNING; --budget)
+    {
+        size_t row = state_;
+        for (int a = 0; a < k; ++a)
+            row = row * num_letters + static_cast<TapeType *>(tape[a])->read(heads[a]);
+        const int32_t *record = &records[row * stride];
+        if (record[0] == DENSE_NO_TRANSITION)
+        {
+            if (expander)
+            {
+                missing = true;
+                break;
+            }
+            message_ = "No transition from this configuration";
+            status_ = SIM_REJECT;
+            break;
+        }
+        int fall_off = -1;
+        for (int a = 0; a < k; ++a)
+            if (record[1 + k + a] < 0 && !heads[a] && fall_off < 0)
+                fall_off = a;
+        if (fall_off >= 0)
+        {
+            message_ = "Head " + to_string(fall_off + 1) + " falls off the tape in the next transition";
+            status_ = SIM_REJECT;
+            break;
+        }
+        for (int a = 0; a < k; ++a)
+        {
+            static_cast<TapeType *>(tape[a])->write(heads[a], record[1 + a]);
+            heads[a] += record[1 + k + a];
+        }
+        state_ = record[0];
+        ++steps_;
+        if (state_ < DENSE_RUNNING)
+            status_ = state_ == DENSE_ACCEPT ? SIM_ACCEPT : SIM_REJECT;
+    }
+    return status_;
+}
+
+vector<string> DenseSimulator::tape_contents(int a, size_t length)
+{
+    vector<string> cells;
+    for (size_t pos = 0; pos < length; ++pos)
+        cells.push_back(dense.letters[tapes_[a]->read(pos)]);
+    return cells;
+}
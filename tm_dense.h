@@ -0,0 +1,101 @@
+#ifndef __TM_DENSE_H
+#define __TM_DENSE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "turing_machine.h"
+#include "tm_layout.h"
+#include "tm_simulator.h"
+#include "tm_tape.h"
+
+// State numbers in dense tables; states below DENSE_RUNNING halt the run
+#define DENSE_ACCEPT 0
+#define DENSE_REJECT 1
+#define DENSE_NO_TRANSITION 2
+#define DENSE_IDLE 3 // no run (lanes of the batch engine without input)
+#define DENSE_RUNNING 4
+
+// Transitions of a machine as a dense table: states and letters are numbered (blank is letter 0),
+// row state * num_letters^num_tapes + letters under heads holds the next state, new letters and head moves.
+// Missing transitions lead to DENSE_NO_TRANSITION, halting states stay in place.
+struct DenseMachine
+{
+    int num_tapes;
+    int32_t num_letters; // per row of the table (more than letters.size() after add_transitions)
+    int32_t initial;
+    std::vector<std::string> letters; // by number
+    std::vector<std::string> states;
+    std::map<std::string, int32_t> letter_ids, state_ids;
+    std::vector<int32_t> next_state;
+    std::vector<std::vector<int32_t>> new_letter, head_move; // for each tape
+
+    // States and letters are numbered in the order of the layout (if given), so that rows
+    // of hot states are next to each other; throws length_error if the table would be too large
+    DenseMachine(const TuringMachine &tm, const Layout *layout = nullptr);
+
+    // Fills rows of transitions (of machines built lazily); new states and letters get the next
+    // numbers, the ones already used keep theirs. Returns the number of rows which had no transition.
+    size_t add_transitions(const transitions_t &more);
+
+private:
+    void init_rows(size_t begin);
+    void resize_table(int32_t old_letters, size_t old_states);
+    bool set_row(const transitions_t::key_type &k, const transitions_t::mapped_type &v);
+};
+
+// Number of rows of the dense table of tm (SIZE_MAX if it does not fit in size_t)
+size_t dense_table_size(const TuringMachine &tm);
+
+// Run of a machine in the dense form, with tapes of letter numbers kept by any Tape backend.
+// The step loop is specialized for 1, 2 and 3 tapes and for VectorTape tapes, whose cells
+// are accessed without virtual calls (chosen when the simulator is created).
+class DenseSimulator
+{
+public:
+    // tapes - one for each tape of the machine
+    DenseSimulator(const DenseMachine &machine, std::vector<std::unique_ptr<Tape>> tapes);
+
+    // Invalid letters in word set the status to SIM_ERROR
+    SimulatorStatus reset(const std::vector<std::string> &word);
+    SimulatorStatus run(size_t budget);
+    // Called on a row without transition; the expander may add transitions leaving the state
+    // to the machine (DenseMachine::add_transitions), their rows are then used by the run
+    void set_expander(StateExpander state_expander) { expander = state_expander; }
+
+    SimulatorStatus status() const { return status_; }
+    const std::string &message() const { return message_; }
+    size_t steps() const { return steps_; }
+    const std::string &state() const { return dense.states[state_]; }
+    const std::vector<size_t> &heads() const { return heads_; }
+    const Tape &tape(int a) const { return *tapes_[a]; }
+    // Names of the letters in cells [0, length) of tape a
+    std::vector<std::string> tape_contents(int a, size_t length);
+
+private:
+    const DenseMachine &dense;
+    // Row of the table as one record: next state, new letters, head moves (-1, 0, 1)
+    std::vector<int32_t> records;
+    int32_t loaded_letters; // letters per row of the table when records were made
+    StateExpander expander;
+    bool missing = false; // run loop stopped at a row without transition (with expander)
+    typedef SimulatorStatus (DenseSimulator::*RunLoop)(size_t budget);
+    RunLoop run_loop;
+    std::vector<std::unique_ptr<Tape>> tapes_;
+    std::vector<Tape *> raw_tapes;
+    std::vector<size_t> heads_;
+    int32_t state_;
+    size_t steps_;
+    SimulatorStatus status_;
+    std::string message_;
+
+    // K - number of tapes, 0 - any; TapeType - class of all tapes (Tape - any)
+    template<int K, typename TapeType> SimulatorStatus run_tapes(size_t budget);
+    template<typename TapeType> static RunLoop choose_loop(int num_tapes);
+    void load_rows(size_t begin, size_t end);
+};
+
+#endif
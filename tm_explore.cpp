@@ -0,0 +1,339 @@
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include "tm_explore.h"
+
+using namespace std;
+
+// States and letters are numbered; tapes keep no trailing blanks.
+// Only configurations of the current level are kept whole; visited ones are remembered
+// by 64-bit fingerprints. Two distinct configurations with the same fingerprint would make
+// the search skip the second one - for 10^7 configurations the probability is about 3 * 10^-6.
+struct Configuration
+{
+    uint32_t state;
+    vector<size_t> heads;
+    vector<vector<uint32_t>> tapes;
+    uint64_t tape_hash; // xor of cell_hash() of all cells
+
+    uint64_t fingerprint() const
+    {
+        return fingerprint(state, heads, tape_hash);
+    }
+
+    static uint64_t fingerprint(uint32_t state, const vector<size_t> &heads, uint64_t tape_hash)
+    {
+        uint64_t hash = mix(tape_hash ^ state);
+        for (size_t head : heads)
+            hash = mix(hash ^ head);
+        return hash;
+    }
+
+    // Zobrist-like hash of a letter in a cell; blanks hash to 0, so trailing blanks do not count
+    static uint64_t cell_hash(size_t tape, size_t position, uint32_t letter)
+    {
+        return letter ? mix(mix(position * 64 + tape) ^ letter) : 0;
+    }
+
+    // splitmix64 finalizer
+    static uint64_t mix(uint64_t value)
+    {
+        value += 0x9e3779b97f4a7c15ull;
+        value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+        value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+        return value ^ (value >> 31);
+    }
+};
+
+// Hash set of fingerprints split into shards with separate locks
+class ConcurrentFingerprintSet
+{
+public:
+    // false if the fingerprint was already there
+    bool insert(uint64_t fingerprint)
+    {
+        Shard &shard = shards[fingerprint % NUM_SHARDS];
+        lock_guard<mutex> lock(shard.lock);
+        if (!shard.fingerprints.insert(fingerprint).second)
+            return false;
+        ++count;
+        return true;
+    }
+
+    size_t size() const
+    {
+        return count;
+    }
+
+private:
+    static const size_t NUM_SHARDS = 64;
+    struct Shard
+    {
+        mutex lock;
+        unordered_set<uint64_t> fingerprints;
+    };
+    Shard shards[NUM_SHARDS];
+    atomic<size_t> count{0};
+};
+
+struct Move
+{
+    uint32_t state;
+    vector<uint32_t> letters;
+    vector<int> moves;
+};
+
+class Explorer
+{
+public:
+    Explorer(const NondeterministicTuringMachine &tm)
+    {
+        letter_id(BLANK);
+        state_id(INITIAL_STATE);
+        accepting = state_id(ACCEPTING_STATE);
+        rejecting = state_id(REJECTING_STATE);
+        for (auto &[k, v] : tm.transitions)
+        {
+            vector<uint32_t> key{state_id(k.first)};
+            for (auto &letter : k.second)
+                key.push_back(letter_id(letter));
+            Move move{state_id(get<0>(v)), {}, {}};
+            for (auto &letter : get<1>(v))
+                move.letters.push_back(letter_id(letter));
+            for (char dir : get<2>(v))
+                move.moves.push_back(dir == HEAD_LEFT ? -1 : dir == HEAD_RIGHT ? 1 : 0);
+            transitions[key].push_back(move);
+        }
+    }
+
+    Configuration initial(int num_tapes, const vector<string> &input)
+    {
+        Configuration config{0, vector<size_t>(num_tapes), vector<vector<uint32_t>>(num_tapes), 0};
+        for (auto &letter : input)
+        {
+            config.tapes[0].push_back(letter_id(letter));
+            config.tape_hash ^= Configuration::cell_hash(0, config.tapes[0].size() - 1, config.tapes[0].back());
+        }
+        return config;
+    }
+
+    // Appends to next the successors of config for which is_new(fingerprint) holds;
+    // config is consumed - its tapes go to the last successor. Returns true if a successor accepts.
+    template<typename IsNew>
+    bool expand(Configuration &config, vector<Configuration> &next, IsNew is_new) const
+    {
+        size_t num_tapes = config.tapes.size();
+        vector<uint32_t> key{config.state};
+        for (size_t a = 0; a < num_tapes; ++a)
+            key.push_back(letter_under_head(config, a));
+        auto it = transitions.find(key);
+        if (it == transitions.end())
+            return false;
+
+        // successors are told apart by fingerprints computed from the written cells,
+        // tapes are rebuilt only for the new ones
+        vector<pair<const Move *, Configuration>> found;
+        for (auto &move : it->second)
+        {
+            if (move.state == rejecting)
+                continue;
+            Configuration succ{move.state, config.heads, {}, config.tape_hash};
+            bool falls_off = false;
+            for (size_t a = 0; a < num_tapes; ++a)
+            {
+                succ.tape_hash ^= Configuration::cell_hash(a, config.heads[a], key[a + 1])
+                                ^ Configuration::cell_hash(a, config.heads[a], move.letters[a]);
+                if (move.moves[a] < 0 && !succ.heads[a])
+                    falls_off = true;
+                succ.heads[a] += move.moves[a];
+            }
+            if (falls_off)
+                continue;
+            if (succ.state == accepting)
+                return true;
+            if (is_new(succ.fingerprint()))
+                found.emplace_back(&move, std::move(succ));
+        }
+        for (size_t b = 0; b < found.size(); ++b)
+        {
+            Configuration &succ = found[b].second;
+            if (b + 1 < found.size())
+                succ.tapes = config.tapes;
+            else
+                succ.tapes = std::move(config.tapes);
+            for (size_t a = 0; a < num_tapes; ++a)
+            {
+                auto &tape = succ.tapes[a];
+                size_t head = config.heads[a];
+                if (head >= tape.size())
+                    tape.resize(head + 1, 0);
+                tape[head] = found[b].first->letters[a];
+                while (!tape.empty() && tape.back() == 0)
+                    tape.pop_back();
+            }
+            next.push_back(std::move(succ));
+        }
+        return false;
+    }
+
+private:
+    map<string, uint32_t> states, letters;
+    map<vector<uint32_t>, vector<Move>> transitions; // (state, letters) -> all possible moves
+    uint32_t accepting, rejecting;
+
+    uint32_t state_id(const string &state)
+    {
+        return states.emplace(state, states.size()).first->second;
+    }
+
+    uint32_t letter_id(const string &letter)
+    {
+        return letters.emplace(letter, letters.size()).first->second;
+    }
+
+    static uint32_t letter_under_head(const Configuration &config, size_t tape)
+    {
+        return config.heads[tape] < config.tapes[tape].size() ? config.tapes[tape][config.heads[tape]] : 0;
+    }
+};
+
+// Threads kept for the whole search; run() executes a job on all of them
+// (the calling thread included) and returns when every thread has finished it
+class WorkerPool
+{
+public:
+    WorkerPool(unsigned num_threads)
+    {
+        for (unsigned t = 1; t < num_threads; ++t)
+            workers.emplace_back([this, t]() { work(t); });
+    }
+
+    ~WorkerPool()
+    {
+        {
+            lock_guard<mutex> guard(lock);
+            stopping = true;
+            ++generation;
+        }
+        wake.notify_all();
+        for (auto &worker : workers)
+            worker.join();
+    }
+
+    // job(t) is called for t = 0, ..., size() - 1; t = 0 on the calling thread
+    void run(const function<void(unsigned)> &job)
+    {
+        {
+            lock_guard<mutex> guard(lock);
+            current = &job;
+            running = workers.size();
+            ++generation;
+        }
+        wake.notify_all();
+        job(0);
+        unique_lock<mutex> guard(lock);
+        finished.wait(guard, [this]() { return !running; });
+    }
+
+    unsigned size() const
+    {
+        return workers.size() + 1;
+    }
+
+private:
+    vector<thread> workers;
+    mutex lock;
+    condition_variable wake, finished;
+    const function<void(unsigned)> *current = nullptr;
+    size_t generation = 0, running = 0;
+    bool stopping = false;
+
+    void work(unsigned t)
+    {
+        for (size_t seen = 0;;)
+        {
+            const function<void(unsigned)> *job;
+            {
+                unique_lock<mutex> guard(lock);
+                wake.wait(guard, [&]() { return generation != seen; });
+                seen = generation;
+                if (stopping)
+                    return;
+                job = current;
+            }
+            (*job)(t);
+            lock_guard<mutex> guard(lock);
+            if (!--running)
+                finished.notify_one();
+        }
+    }
+};
+
+// Smaller levels are expanded on the calling thread only
+#define PARALLEL_FRONTIER 256
+
+ExploreResult explore(const NondeterministicTuringMachine &tm, const vector<string> &input,
+    const ExploreLimits &limits, bool verbose)
+{
+    Explorer explorer(tm);
+    WorkerPool pool(limits.threads ? limits.threads : max(1u, thread::hardware_concurrency()));
+    vector<vector<Configuration>> next(pool.size());
+
+    ConcurrentFingerprintSet visited;
+    vector<Configuration> frontier{explorer.initial(tm.num_tapes, input)};
+    visited.insert(frontier[0].fingerprint());
+    atomic<bool> accepted{false}, limit_reached{false};
+
+    for (size_t step = 0; !frontier.empty(); ++step)
+    {
+        if (step >= limits.max_steps)
+        {
+            limit_reached = true;
+            break;
+        }
+        atomic<size_t> position{0};
+        auto expand_level = [&](unsigned t) {
+            auto is_new = [&](uint64_t fingerprint) {
+                if (visited.size() >= limits.max_configurations)
+                {
+                    limit_reached = true;
+                    return false;
+                }
+                return visited.insert(fingerprint);
+            };
+            for (size_t i; !accepted && !limit_reached && (i = position++) < frontier.size();)
+                if (explorer.expand(frontier[i], next[t], is_new))
+                    accepted = true;
+        };
+        if (frontier.size() < PARALLEL_FRONTIER)
+            expand_level(0);
+        else
+            pool.run(expand_level);
+        if (accepted)
+        {
+            if (verbose)
+                cerr << "Accepting branch found after " << step + 1 << " steps, "
+                     << visited.size() << " configurations visited\n";
+            return EXPLORE_ACCEPT;
+        }
+        if (limit_reached)
+            break;
+        frontier.clear();
+        for (auto &part : next)
+        {
+            for (auto &config : part)
+                frontier.push_back(std::move(config));
+            part.clear();
+        }
+    }
+    if (verbose)
+        cerr << visited.size() << " configurations visited"
+             << (limit_reached ? ", limit reached before the search was completed" : "") << "\n";
+    return limit_reached ? EXPLORE_LIMIT : EXPLORE_REJECT;
+}
@@ -0,0 +1,23 @@
+#ifndef __TM_EXPLORE_H
+#define __TM_EXPLORE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "turing_machine.h"
+
+enum ExploreResult { EXPLORE_ACCEPT, EXPLORE_REJECT, EXPLORE_LIMIT };
+
+struct ExploreLimits
+{
+    size_t max_configurations = 10000000; // distinct configurations remembered (as fingerprints, ~40 bytes each)
+    size_t max_steps = 1000000; // depth of the search
+    unsigned threads = 0; // 0 - one per hardware thread
+};
+
+// Breadth-first search of the configuration graph of a nondeterministic machine;
+// accepts as soon as any branch reaches the accepting state
+ExploreResult explore(const NondeterministicTuringMachine &tm, const std::vector<std::string> &input,
+    const ExploreLimits &limits, bool verbose);
+
+#endif
@@ -1,18 +1,40 @@
 #include <iostream>
 #include <sstream>
 #include <cstddef>
+#include <cstdint>
 #include <cstdlib>
 #include <fstream>
+#include <memory>
+#include <random>
 #include "turing_machine.h"
 #include "tm_convert.h"
+#include "tm_explore.h"
+#include "tm_optimize.h"
+#include "tm_shadow.h"
+#include "tm_batch.h"
+#include "tm_simulator.h"
+#include "tm_layout.h"
+#include "tm_dense.h"
+#include "tm_tape.h"
 
 using namespace std;
 
 static bool verbose = true;
+static bool debug_mode = false;
+static string profile_name; // file for hit counts of transitions
+static string tape_kind; // empty - tapes of strings (Simulator)
+static size_t page_cells = 1 << 16;
+static size_t memory_pages = 16;
+static string scratch_dir = default_scratch_dir();
 
 static void print_usage(string error) {
     cerr << "ERROR: " << error << "\n"
-         << "Usage: tm_interpreter [-q|--quiet] [-ot|--use-original] <input_file> <input>\n";
+         << "Usage: tm_interpreter [-q|--quiet] [-ot|--use-original] [-O|--optimize] [-b|--binary] [-d|--debug]\n"
+         << "                      [-l|--lazy] [--profile <file>] [--shadow [--check-every N] [--seed N]] [--no-layout]\n"
+         << "                      [--tape vector|rle|paged [--page-size N] [--memory-pages N] [--scratch-dir <dir>]]\n"
+         << "                      [-nd|--nondeterministic [--max-configs N] [--max-steps N] [--threads N]] <input_file> <input>\n"
+         << "       tm_interpreter [-q|--quiet] [-ot|--use-original] [-O|--optimize] [-b|--binary] [--no-simd]\n"
+         << "                      [--no-layout] [--max-steps N] --sweep N <input_file>\n";
     exit(1);
 }
 
@@ -21,100 +43,343 @@ void halt(bool accept) {
     exit(0);
 }
 
-vector<vector<string>> tapes;
-vector<size_t> heads;
-string state = INITIAL_STATE;
+// Debugger: executed transitions are recorded, so that every step can be undone
+// (or redone) in constant time; snapshots of the whole configuration are taken
+// every SNAPSHOT_INTERVAL steps for long jumps backwards.
+#define SNAPSHOT_INTERVAL (1 << 16)
 
-void append_blanks_under_heads() {
-    for (size_t a = 0; a < tapes.size(); ++a)
-        if (heads[a] >= tapes[a].size())
-            tapes[a].emplace_back(BLANK);
+struct Snapshot {
+    vector<vector<string>> tapes;
+    vector<size_t> heads;
+    string state;
+};
+
+vector<const transition_t *> history; // transition executed in each step
+vector<unsigned char> history_appended; // tapes extended by a blank in each step
+vector<Snapshot> snapshots; // configuration at step i * SNAPSHOT_INTERVAL
+
+bool step_forward(Simulator &sim) {
+    size_t step_num = sim.steps();
+    if (step_num < history.size()) {
+        sim.apply(*history[step_num]);
+        return true;
+    }
+    if (step_num % SNAPSHOT_INTERVAL == 0 && snapshots.size() == step_num / SNAPSHOT_INTERVAL)
+        snapshots.push_back(Snapshot{sim.tapes(), sim.heads(), sim.state()});
+    auto trans = sim.next_transition();
+    if (!trans)
+        return false;
+    history.push_back(trans);
+    history_appended.push_back(sim.apply(*trans));
+    return true;
 }
 
-void execute_step(const TuringMachine &tm) {
-    pair<string, vector<string>> cur;
-    cur.first = state;
-    for (size_t a = 0; a < tapes.size(); ++a)
-        cur.second.emplace_back(tapes[a][heads[a]]);
-    if (tm.transitions.find(cur) == tm.transitions.end()) {
-        if (verbose)
-            cerr << "No transition from this configuration\n";
-        halt(false);
-    }
-    auto trans = tm.transitions.at(cur);
-    state = get<0>(trans);
-    for (size_t a = 0; a < tapes.size(); ++a) {
-        tapes[a][heads[a]] = get<1>(trans)[a];
-        char dir = get<2>(trans)[a];
-        if (dir == HEAD_LEFT && !heads[a]) {
-            if (verbose)
-                cerr << "Head " << a + 1 << " falls off the tape in the next transition\n";
-            halt(false);
-        }
-        heads[a] += dir == HEAD_LEFT ? -1 : dir == HEAD_RIGHT ? 1 : 0;
-    }
-    append_blanks_under_heads();
+void step_backward(Simulator &sim) {
+    size_t step_num = sim.steps() - 1;
+    sim.undo(*history[step_num], history_appended[step_num]);
 }
 
-void print_configuration() {
-    cerr << "State: " << state << "\n";
-    for (size_t a = 0; a < tapes.size(); ++a) {
-        size_t before_head = 0, after_head = 0;
-        ostringstream oss;
-        oss << "Tape " << (a + 1) << ": ";
-        for (size_t b = 0; b < tapes[a].size(); ++b) {
-            if (b == heads[a])
-                before_head = oss.str().length();
-            oss << tapes[a][b];
-            if (b == heads[a])
-                after_head = oss.str().length();
-        }
-        cerr << oss.str() << "\n";
-        for (size_t b = 0; b < before_head; ++b)
-            cerr << " ";
-        for (size_t b = before_head; b < after_head; ++b)
-            cerr << "^";
-        cerr << "\n";
-    }
-    cerr << "#####################################\n";
+void jump_to(Simulator &sim, size_t target) {
+    if (target < sim.steps()) {
+        size_t snapshot = target / SNAPSHOT_INTERVAL;
+        if (snapshot < snapshots.size() && target - snapshot * SNAPSHOT_INTERVAL < sim.steps() - target)
+            sim.set_configuration(snapshots[snapshot].state, snapshots[snapshot].tapes,
+                snapshots[snapshot].heads, snapshot * SNAPSHOT_INTERVAL);
+    }
+    while (sim.steps() > target)
+        step_backward(sim);
+    while (sim.steps() < target && step_forward(sim));
 }
 
-void run(const TuringMachine &tm, string input)
-{
-    tapes.resize(tm.num_tapes);
-    heads.resize(tm.num_tapes);
-    tapes[0] = tm.parse_input(input);
+void debug(Simulator &sim) {
+    cerr << "Commands: s [n] - step forward, b [n] - step backward, j <n> - jump to step n,\n"
+         << "          u <text> - run until the state contains text, p - print, q - quit\n";
+    sim.print_configuration(cerr);
+    string line;
+    while (cerr << "Step " << sim.steps() << "> " && getline(cin, line)) {
+        istringstream iss(line);
+        string command, arg;
+        iss >> command >> arg;
+        size_t count = 1;
+        if (!arg.empty() && command != "u")
+            try {
+                count = stoull(arg);
+            } catch (...) {
+                cerr << "Number expected\n";
+                continue;
+            }
+        if (command == "" || command == "s") {
+            size_t target = sim.steps() + count;
+            jump_to(sim, target);
+        }
+        else if (command == "b")
+            jump_to(sim, sim.steps() - min(count, sim.steps()));
+        else if (command == "j")
+            jump_to(sim, count);
+        else if (command == "u") {
+            while (step_forward(sim) && sim.state().find(arg) == string::npos);
+        }
+        else if (command == "q")
+            break;
+        else if (command != "p") {
+            cerr << "Unknown command\n";
+            continue;
+        }
+        sim.print_configuration(cerr);
+        if (sim.status() != SIM_RUNNING)
+            cerr << (sim.status() == SIM_ACCEPT ? "ACCEPT" : "REJECT") << "\n";
+        else if (!sim.next_transition()) // the run stops here (no transition or a head falls off)
+            cerr << sim.message() << "\nREJECT\n";
+    }
+    exit(0);
+}
 
-    if (tapes[0].empty() && input != "") {
+unique_ptr<Tape> make_tape() {
+    if (tape_kind == "paged")
+        return make_unique<PagedTape>(page_cells, memory_pages, scratch_dir);
+    if (tape_kind == "rle")
+        return make_unique<RunLengthTape>();
+    return make_unique<VectorTape>();
+}
+
+// Runs the machine in the dense form, on tapes of letter numbers; tapes too long
+// to be printed are only summarized
+void run_on_tapes(const TuringMachine &tm, const Layout *layout, string input) {
+    vector<string> word = tm.parse_input(input);
+    if (word.empty() && input != "") {
         cerr << "ERROR: The last argument is not a sequence of input letters\n";
         exit(1);
     }
-    append_blanks_under_heads();
+    try {
+        DenseMachine dense(tm, layout);
+        vector<unique_ptr<Tape>> tapes;
+        for (int a = 0; a < tm.num_tapes; ++a)
+            tapes.push_back(make_tape());
+        DenseSimulator sim(dense, std::move(tapes));
+        sim.reset(word);
+        sim.run(SIZE_MAX);
+        if (verbose) {
+            if (!sim.message().empty())
+                cerr << sim.message() << "\n";
+            cerr << "State: " << sim.state() << "\nSteps: " << sim.steps() << "\n";
+            for (int a = 0; a < tm.num_tapes; ++a) {
+                cerr << "Tape " << a + 1 << ": head at " << sim.heads()[a] << ", ";
+                sim.tape(a).print_stats(cerr);
+                cerr << "\n";
+            }
+        }
+        halt(sim.status() == SIM_ACCEPT);
+    } catch (exception &e) {
+        cerr << "ERROR: " << e.what() << "\n";
+        exit(1);
+    }
+}
+
+// Plain runs of machines with a dense table of at most this many rows go through DenseSimulator
+#define MAX_PLAIN_DENSE_TABLE (1 << 20)
 
+// Same output as the run on a Simulator; printed tapes reach the furthest visited cell.
+// With a lazy converter, rows of states are filled when the run enters them; if the table
+// grows too large, the function returns (only runs without printing are started so).
+void run_dense(const TuringMachine &tm, const Layout *layout, string input, const LazyConverter *converter = nullptr) {
+    vector<string> word = tm.parse_input(input);
+    if (word.empty() && input != "") {
+        cerr << "ERROR: The last argument is not a sequence of input letters\n";
+        exit(1);
+    }
+    DenseMachine dense(tm, layout);
+    vector<unique_ptr<Tape>> tapes;
+    for (int a = 0; a < tm.num_tapes; ++a)
+        tapes.push_back(make_unique<VectorTape>());
+    DenseSimulator sim(dense, std::move(tapes));
+    if (converter)
+        sim.set_expander([&](const string &state) {
+            size_t added = dense.add_transitions(converter->transitions_from(state));
+            if (dense.next_state.size() > MAX_PLAIN_DENSE_TABLE)
+                throw length_error("Lazily converted machine is too large for the dense transition table");
+            return added != 0;
+        });
+    sim.reset(word);
+    vector<size_t> visited(tm.num_tapes, 1);
+    visited[0] = max<size_t>(word.size(), 1);
+    auto print = [&]() {
+        vector<vector<string>> contents;
+        for (int a = 0; a < tm.num_tapes; ++a) {
+            visited[a] = max(visited[a], sim.heads()[a] + 1);
+            contents.push_back(sim.tape_contents(a, visited[a]));
+        }
+        print_configuration(cerr, sim.state(), contents, sim.heads());
+    };
     if (verbose)
-        print_configuration();
-    for (;;) {
-        execute_step(tm);
-        if (verbose)
-            print_configuration();
-        if (state == REJECTING_STATE)
-            halt(false);
-        if (state == ACCEPTING_STATE)
-            halt(true);
+        print();
+    // Without printing, the machine runs without interruptions
+    try {
+        while (sim.run(verbose ? 1 : SIZE_MAX) == SIM_RUNNING)
+            print();
+    } catch (length_error &) {
+        return;
+    }
+    if (verbose) {
+        if (!sim.message().empty())
+            cerr << sim.message() << "\n";
+        else
+            print();
     }
+    halt(sim.status() == SIM_ACCEPT);
+}
+
+// layout - numbering of the dense table (if the run goes through one)
+void run(const TuringMachine &tm, const Layout *layout, string input, StateExpander expander = nullptr)
+{
+    if (!tape_kind.empty())
+        run_on_tapes(tm, layout, input);
+    if (!expander && !debug_mode && profile_name.empty() && dense_table_size(tm) <= MAX_PLAIN_DENSE_TABLE)
+        run_dense(tm, layout, input);
+    Simulator sim(tm);
+    sim.set_expander(expander);
+    unordered_map<const transition_t *, unsigned long long> hits;
+    if (!profile_name.empty())
+        sim.set_hit_counter(&hits);
+    if (sim.reset(input) == SIM_ERROR) {
+        cerr << "ERROR: The last argument is not a sequence of input letters\n";
+        exit(1);
+    }
+
+    if (debug_mode)
+        debug(sim);
+    if (verbose)
+        sim.print_configuration(cerr);
+    // Without printing, the machine runs without interruptions
+    while (sim.run(verbose ? 1 : SIZE_MAX) == SIM_RUNNING)
+        sim.print_configuration(cerr);
+    if (!profile_name.empty()) {
+        profile_t profile;
+        for (auto &[trans, count] : hits)
+            profile[trans->first] = count;
+        ofstream profile_file(profile_name);
+        save_profile(profile_file, profile);
+    }
+    if (verbose) {
+        if (!sim.message().empty())
+            cerr << sim.message() << "\n";
+        else
+            sim.print_configuration(cerr);
+    }
+    halt(sim.status() == SIM_ACCEPT);
+}
+
+// Runs the machine on all words over the input alphabet of length at most max_length,
+// the runs are executed in lockstep by the batch engine
+void sweep(const TuringMachine &tm, const Layout *layout, size_t max_length, size_t max_steps, bool use_simd) {
+    vector<vector<string>> inputs{{}};
+    for (size_t begin = 0, end = 1, length = 1; length <= max_length; ++length) {
+        for (size_t a = begin; a < end; ++a)
+            for (auto &letter : tm.input_alphabet()) {
+                inputs.push_back(inputs[a]);
+                inputs.back().push_back(letter);
+            }
+        begin = end;
+        end = inputs.size();
+    }
+    vector<BatchResult> results = BatchRunner(tm, layout).run(inputs, max_steps, nullptr, use_simd);
+    size_t accepted = 0, unknown = 0;
+    for (size_t a = 0; a < inputs.size(); ++a) {
+        accepted += results[a] == BATCH_ACCEPT;
+        unknown += results[a] == BATCH_LIMIT;
+        if (verbose) {
+            string word;
+            for (auto &letter : inputs[a])
+                word += letter;
+            cout << (word.empty() ? "(empty)" : word) << " "
+                 << (results[a] == BATCH_ACCEPT ? "ACCEPT" : results[a] == BATCH_REJECT ? "REJECT" : "UNKNOWN") << "\n";
+        }
+    }
+    cout << "Accepted " << accepted << " of " << inputs.size() << " words";
+    if (unknown)
+        cout << ", " << unknown << " not decided in " << max_steps << " steps";
+    cout << "\n";
 }
 
 int main(int argc, char* argv[]) {
     string filename;
     string input;
     bool use_original = true;
+    bool nondeterministic = false;
+    bool optimize = false;
+    bool binary = false;
+    bool shadow = false;
+    bool lazy = false;
+    size_t check_every = 1000;
+    uint64_t shadow_seed = random_device{}(); // of the spot checks
+    bool sweeping = false, use_simd = true, use_layout = true;
+    size_t sweep_length = 0;
+    ExploreLimits limits;
     int ok = 0;
     for (int i = 1; i < argc; i++) {
         string arg = argv[i];
+        auto number = [&]() {
+            if (i + 1 >= argc)
+                print_usage("Number expected after " + arg);
+            try {
+                return stoull(argv[++i]);
+            } catch (...) {
+                print_usage("Number expected after " + arg);
+            }
+            return 0ull;
+        };
         if (arg == "--quiet" || arg == "-q")
             verbose = false;
         else if (arg == "-ot" || arg == "--one-taped")
             use_original = false;
+        else if (arg == "-O" || arg == "--optimize")
+            optimize = true;
+        else if (arg == "-b" || arg == "--binary")
+            binary = true;
+        else if (arg == "-l" || arg == "--lazy")
+            lazy = true;
+        else if (arg == "--shadow")
+            shadow = true;
+        else if (arg == "--check-every")
+            check_every = number();
+        else if (arg == "--seed")
+            shadow_seed = number();
+        else if (arg == "--sweep") {
+            sweeping = true;
+            sweep_length = number();
+        }
+        else if (arg == "--no-simd")
+            use_simd = false;
+        else if (arg == "--tape") {
+            if (i + 1 >= argc || (string(argv[i + 1]) != "vector" && string(argv[i + 1]) != "paged" && string(argv[i + 1]) != "rle"))
+                print_usage("vector, paged or rle expected after " + arg);
+            tape_kind = argv[++i];
+        }
+        else if (arg == "--page-size")
+            page_cells = number();
+        else if (arg == "--memory-pages")
+            memory_pages = number();
+        else if (arg == "--scratch-dir") {
+            if (i + 1 >= argc)
+                print_usage("Directory expected after " + arg);
+            scratch_dir = argv[++i];
+        }
+        else if (arg == "--no-layout")
+            use_layout = false;
+        else if (arg == "--profile") {
+            if (i + 1 >= argc)
+                print_usage("File name expected after " + arg);
+            profile_name = argv[++i];
+        }
+        else if (arg == "-d" || arg == "--debug")
+            debug_mode = true;
+        else if (arg == "-nd" || arg == "--nondeterministic")
+            nondeterministic = true;
+        else if (arg == "--max-configs")
+            limits.max_configurations = number();
+        else if (arg == "--max-steps")
+            limits.max_steps = number();
+        else if (arg == "--threads")
+            limits.threads = number();
         else {
             if (ok == 0)
                 filename = arg;
@@ -126,26 +391,106 @@ int main(int argc, char* argv[]) {
             ++ok;
         }
     }
-    if (ok != 2)
+    if (sweeping && ok == 2)
+        print_usage("No input expected with --sweep");
+    if (ok != 2 - sweeping)
         print_usage("Not enough arguments");
+    if (sweeping && (nondeterministic || debug_mode || shadow))
+        print_usage("--sweep works only with plain deterministic runs");
+    if (!profile_name.empty() && (sweeping || nondeterministic || debug_mode || shadow))
+        print_usage("--profile works only with plain deterministic runs");
+    if (!tape_kind.empty() && (sweeping || nondeterministic || debug_mode || shadow || lazy || !profile_name.empty()))
+        print_usage("--tape works only with plain deterministic runs");
 
     FILE *f = fopen(filename.c_str(), "r");
     if (!f) {
         cerr << "ERROR: File " << filename << " does not exist\n";
         return 1;
     }
+
+    if (nondeterministic)
+    {
+        if (!use_original || debug_mode)
+            print_usage("Nondeterministic machines can only be run directly");
+        NondeterministicTuringMachine ntm = read_ntm_from_file(f);
+        vector<string> word = ntm.parse_input(input);
+        if (word.empty() && input != "") {
+            cerr << "ERROR: The last argument is not a sequence of input letters\n";
+            exit(1);
+        }
+        cout << "Nondeterministic turing machine: \n";
+        ExploreResult result = explore(ntm, word, limits, verbose);
+        if (result == EXPLORE_LIMIT) {
+            cout << "UNKNOWN\n";
+            return 0;
+        }
+        halt(result == EXPLORE_ACCEPT);
+    }
+
     TuringMachine tm = read_tm_from_file(f);
+
+    // Layout saved by tm_translator next to the machine, if the machine is run as it is
+    Layout layout;
+    ifstream layout_file(filename + ".layout");
+    bool has_layout = use_layout && use_original && layout_file && read_layout(layout_file, layout);
+
+    if (sweeping)
+    {
+        if (!use_original) {
+            if (optimize)
+                tm = tm_optimize(tm);
+            tm = binary ? tm_convert_binary(tm) : tm_convert(tm);
+        }
+        if (has_layout && verbose)
+            cerr << "Using layout " << filename << ".layout\n";
+        sweep(tm, has_layout ? &layout : nullptr, sweep_length, limits.max_steps, use_simd);
+        return 0;
+    }
     
     if (use_original)
     {
         cout << "Original turing machine: \n";
-        run(tm, input);
+        run(tm, has_layout ? &layout : nullptr, input);
     }
     else 
     {
-        TuringMachine one_taped_tm = tm_convert(tm);
+        if (optimize)
+            tm = tm_optimize(tm);
+        if (shadow)
+        {
+            // The one-taped machine is not run, its run is computed from the original one
+            if (binary || debug_mode)
+                print_usage("--shadow works only with the default conversion");
+            vector<string> word = tm.parse_input(input);
+            if (word.empty() && input != "") {
+                cerr << "ERROR: The last argument is not a sequence of input letters\n";
+                exit(1);
+            }
+            cout << "Constructed, one-taped turing machine (shadow run): \n";
+            ShadowResult result = shadow_run(tm, word, check_every, shadow_seed);
+            if (verbose) {
+                print_configuration(cerr, result.state, {result.tape}, {result.head});
+                cerr << "Steps: " << result.steps << ", spot checks passed: " << result.checks
+                     << " (seed " << shadow_seed << ")\n";
+            }
+            halt(result.accept);
+        }
+        if (lazy)
+        {
+            // Transitions of the one-taped machine are generated when they are needed
+            if (binary)
+                print_usage("--lazy works only with the default conversion");
+            LazyConverter converter(tm);
+            cout << "Constructed, one-taped turing machine (lazily): \n";
+            // Rows of the dense table are filled as the run enters states; runs printing
+            // every step (and debugged or profiled ones) expand the machine in Simulator
+            if (!verbose && !debug_mode && profile_name.empty())
+                run_dense(converter.machine(), nullptr, input, &converter);
+            run(converter.machine(), nullptr, input, [&](const string &s) { return converter.expand(s); });
+        }
+        TuringMachine one_taped_tm = binary ? tm_convert_binary(tm) : tm_convert(tm);
         cout << "Constructed, one-taped turing machine: \n";
-        run(one_taped_tm, input);
+        run(one_taped_tm, nullptr, input);
     }
 
 }
@@ -0,0 +1,101 @@
+#include <algorithm>
+#include <sstream>
+#include "tm_layout.h"
+
+using namespace std;
+
+void save_profile(ostream &output, const profile_t &profile)
+{
+    for (auto &[k, count] : profile)
+    {
+        output << count << " " << k.first;
+        for (auto &letter : k.second)
+            output << " " << letter;
+        output << "\n";
+    }
+}
+
+bool read_profile(istream &input, profile_t &profile)
+{
+    string line;
+    while (getline(input, line))
+    {
+        istringstream iss(line);
+        unsigned long long count;
+        pair<string, vector<string>> k;
+        if (!(iss >> count))
+        {
+            if (line.find_first_not_of(" \t\r") == string::npos)
+                continue;
+            return false;
+        }
+        if (!(iss >> k.first))
+            return false;
+        for (string letter; iss >> letter;)
+            k.second.push_back(letter);
+        if (k.second.empty())
+            return false;
+        profile[k] += count;
+    }
+    return true;
+}
+
+// Keys with positive counts, descending by count (ties in the name order)
+static vector<string> by_count(const map<string, unsigned long long> &counts)
+{
+    vector<pair<unsigned long long, string>> order;
+    for (auto &[name, count] : counts)
+        if (count)
+            order.emplace_back(count, name);
+    stable_sort(order.begin(), order.end(), [](auto &a, auto &b) { return a.first > b.first; });
+    vector<string> names;
+    for (auto &entry : order)
+        names.push_back(entry.second);
+    return names;
+}
+
+Layout profile_layout(const TuringMachine &tm, const profile_t &profile)
+{
+    map<string, unsigned long long> state_hits, letter_hits;
+    for (auto &[k, count] : profile)
+    {
+        // Transitions which are not in the machine (profile of another machine) are ignored
+        if (tm.transitions().find(k) == tm.transitions().end())
+            continue;
+        state_hits[k.first] += count;
+        for (auto &letter : k.second)
+            letter_hits[letter] += count;
+    }
+    return Layout{by_count(state_hits), by_count(letter_hits)};
+}
+
+static void save_names(ostream &output, const string &header, const vector<string> &names)
+{
+    output << header << ": " << names.size() << "\n";
+    for (auto &name : names)
+        output << name << "\n";
+}
+
+static bool read_names(istream &input, const string &header, vector<string> &names)
+{
+    string word;
+    size_t count;
+    if (!(input >> word) || word != header + ":" || !(input >> count))
+        return false;
+    names.resize(count);
+    for (auto &name : names)
+        if (!(input >> name))
+            return false;
+    return true;
+}
+
+void save_layout(ostream &output, const Layout &layout)
+{
+    save_names(output, "states", layout.states);
+    save_names(output, "letters", layout.letters);
+}
+
+bool read_layout(istream &input, Layout &layout)
+{
+    return read_names(input, "states", layout.states) && read_names(input, "letters", layout.letters);
+}
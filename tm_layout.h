@@ -0,0 +1,36 @@
+#ifndef __TM_LAYOUT_H
+#define __TM_LAYOUT_H
+
+#include <istream>
+#include <map>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "turing_machine.h"
+
+// Number of executions of each transition in a run (profile), by the left side of the transition.
+// Saved as lines "<count> <state> <letter 1> ... <letter k>".
+typedef std::map<std::pair<std::string, std::vector<std::string>>, unsigned long long> profile_t;
+
+void save_profile(std::ostream &output, const profile_t &profile);
+// Counts of the same transitions are added up; returns false on malformed input
+bool read_profile(std::istream &input, profile_t &profile);
+
+// Order of state and letter numbers in dense transition tables, hottest first
+// (states and letters missing here follow in the default order).
+// Saved next to the translated machine, in <machine file>.layout
+struct Layout
+{
+    std::vector<std::string> states;
+    std::vector<std::string> letters;
+};
+
+// States by the number of executed transitions leaving them, letters by the number of times
+// they were read; never executed ones are left out
+Layout profile_layout(const TuringMachine &tm, const profile_t &profile);
+
+void save_layout(std::ostream &output, const Layout &layout);
+bool read_layout(std::istream &input, Layout &layout);
+
+#endif
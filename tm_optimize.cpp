@@ -0,0 +1,72 @@
+#include <set>
+#include <string>
+#include <vector>
+#include "tm_optimize.h"
+
+using namespace std;
+
+// Optimizations of a Turing Machine before conversion.
+// Every step of the original machine costs O(tape length) steps of the one-taped machine,
+// so a step which moves no head is composed with the step following it
+// (the letters under the heads after such a step are known).
+
+static bool is_stay(const string &directions)
+{
+    return directions.find_first_not_of(HEAD_STAY) == string::npos;
+}
+
+// Follows the chain of stay transitions starting from `trans`; stops on a non-stay transition,
+// on a halting state, or on a cycle (then the machine never halts and nothing is changed)
+static transitions_t::mapped_type fuse_stays(const transitions_t &transitions, const transitions_t::mapped_type &trans)
+{
+    auto fused = trans;
+    set<transitions_t::key_type> visited;
+    while (is_stay(get<2>(fused)))
+    {
+        auto key = make_pair(get<0>(fused), get<1>(fused));
+        if (key.first == ACCEPTING_STATE || key.first == REJECTING_STATE)
+            return fused;
+        if (!visited.insert(key).second)
+            return trans;
+        auto next = transitions.find(key);
+        if (next == transitions.end())
+        {
+            // No transition - the machine rejects
+            get<0>(fused) = REJECTING_STATE;
+            return fused;
+        }
+        fused = next->second;
+    }
+    return fused;
+}
+
+TuringMachine tm_optimize(const TuringMachine &tm)
+{
+    transitions_t transitions;
+    for (auto &[k, v] : tm.transitions())
+        transitions[k] = fuse_stays(tm.transitions(), v);
+
+    // Removing states which are not reachable anymore
+    set<string> reachable{INITIAL_STATE};
+    vector<string> pending{INITIAL_STATE};
+    while (!pending.empty())
+    {
+        string state = pending.back();
+        pending.pop_back();
+        for (auto it = transitions.lower_bound(make_pair(state, vector<string>())); 
+             it != transitions.end() && it->first.first == state; ++it)
+        {
+            if (reachable.insert(get<0>(it->second)).second)
+                pending.push_back(get<0>(it->second));
+        }
+    }
+    for (auto it = transitions.begin(); it != transitions.end();)
+    {
+        if (reachable.find(it->first.first) == reachable.end())
+            it = transitions.erase(it);
+        else
+            ++it;
+    }
+
+    return TuringMachine(tm.num_tapes, tm.input_alphabet(), std::move(transitions));
+}
@@ -0,0 +1,10 @@
+#ifndef __TM_OPTIMIZE_H
+#define __TM_OPTIMIZE_H
+
+#include "turing_machine.h"
+
+// Composes transitions which do not move any head with their successors
+// and removes unreachable states; accepts/rejects the same words as tm.
+TuringMachine tm_optimize(const TuringMachine &tm);
+
+#endif
@@ -0,0 +1,224 @@
+#include <iostream>
+#include <random>
+#include "tm_convert.h"
+#include "tm_shadow.h"
+
+using namespace std;
+
+// Run of the one-taped machine is computed from the layout of its tape:
+//   guard | cells 1..L: [v]letter_on_tape_1(-)[v]letter_on_tape_2 | blanks
+// Every step of the original machine (h1, h2 - heads before, h1', h2' - after) is a cycle:
+//   Phase1-Find-Second:     h2 + 1 steps (from cell 1 to the mark of head 2)
+//   Phase1-Set-Second-Mark: 1 step (+ 1 if the tape is extended)
+//   Phase1-Back:            h2' + 1 steps (back to the guard and one step right)
+//   Phase2-Find-First:      h1 + 1 steps
+//   Phase2-Set-First-Mark:  1 step (+ 1 if the tape is extended)
+//   Phase2-Back:            h1' + 1 steps
+
+static const string SIGN = "(-)";
+static const string GUARD = wrap(SIGN + SIGN);
+static const string HEAD = "v";
+
+class Shadow
+{
+public:
+    Shadow(const TuringMachine &tm_) : tm(tm_) {}
+
+    // Phase 0 - returns false if the one-taped machine halts in it
+    bool start(const vector<string> &input)
+    {
+        tapes[0] = input;
+        if (input.empty())
+        {
+            // Empty input corner case
+            if (tm.transitions().find(make_pair(INITIAL_STATE, vector<string>{BLANK, BLANK})) == tm.transitions().end())
+            {
+                result.state = INITIAL_STATE;
+                result.tape = {BLANK};
+                result.head = 0;
+                return halt(false);
+            }
+            tapes[0] = {BLANK};
+            steps = 2;
+        }
+        else
+            steps = 2 * input.size() + 3;
+        length = tapes[0].size();
+        tapes[1].assign(length, BLANK);
+        return true;
+    }
+
+    // Simulates one step of the original machine - returns false if the one-taped machine halts
+    bool cycle()
+    {
+        const string &first = tapes[0][heads[0]];
+        auto trans = tm.transitions().find(make_pair(state, vector<string>{first, tapes[1][heads[1]]}));
+        if (trans == tm.transitions().end())
+        {
+            // Phase1-Find-Second stops at the mark of head 2
+            steps += heads[1];
+            set_result(wrap(PHASE1_FIND_SECOND + SIGN + state + SIGN + first + SIGN + BLANK), heads[1] + 1, true, true);
+            return halt(false);
+        }
+        auto &[new_state, new_letters, directions] = trans->second;
+
+        steps += heads[1] + 1;
+        tapes[1][heads[1]] = new_letters[1];
+        if (!move(1, directions[1]))
+        {
+            set_result(wrap(PHASE1_SET_SECOND_MARK + SIGN + new_state + SIGN + new_letters[0] + SIGN + direction_chr(directions[0])), 0, true, false);
+            return halt(false);
+        }
+        if (new_state == ACCEPTING_STATE)
+        {
+            // Set-Second-Mark of the accepting state accepts immediately
+            ++steps;
+            set_result(ACCEPTING_STATE, heads[1] + 1, true, false);
+            if (heads[1] == length)
+                result.tape.push_back(BLANK);
+            return halt(true);
+        }
+        steps += extend(heads[1]) + 1 + heads[1] + 1;
+
+        steps += heads[0] + 1;
+        tapes[0][heads[0]] = new_letters[0];
+        if (!move(0, directions[0]))
+        {
+            set_result(wrap(PHASE2_SET_FIRST_MARK + SIGN + new_state + SIGN + BLANK + SIGN + BLANK), 0, false, true);
+            return halt(false);
+        }
+        steps += extend(heads[0]) + 1 + heads[0] + 1;
+        state = new_state;
+        return true;
+    }
+
+    // Configuration of the one-taped machine at the beginning of a cycle
+    void set_cycle_start()
+    {
+        set_result(wrap(PHASE1_FIND_SECOND + SIGN + state + SIGN + tapes[0][heads[0]] + SIGN + BLANK), 1, true, true);
+    }
+
+    unsigned long long steps = 0;
+    ShadowResult result{false, 0, "", {}, 0, 0};
+
+private:
+    const TuringMachine &tm;
+    vector<string> tapes[2]; // both of length `length`
+    size_t heads[2] = {0, 0};
+    string state = INITIAL_STATE;
+    size_t length = 0;
+
+    static char direction_chr(char c)
+    {
+        return c == HEAD_LEFT ? 'L' : c == HEAD_RIGHT ? 'R' : c;
+    }
+
+    bool move(int tape, char dir)
+    {
+        if (dir == HEAD_LEFT && !heads[tape])
+            return false; // falls on the guard
+        heads[tape] += dir == HEAD_LEFT ? -1 : dir == HEAD_RIGHT ? 1 : 0;
+        return true;
+    }
+
+    // Blank under the head is extended to a cell in one step
+    int extend(size_t head)
+    {
+        if (head < length)
+            return 0;
+        ++length;
+        tapes[0].emplace_back(BLANK);
+        tapes[1].emplace_back(BLANK);
+        return 1;
+    }
+
+    bool halt(bool accept)
+    {
+        result.accept = accept;
+        result.steps = steps;
+        return false;
+    }
+
+    void set_result(const string &new_state, size_t head, bool mark_first, bool mark_second)
+    {
+        result.state = new_state;
+        result.head = head;
+        result.tape.assign(1, GUARD);
+        for (size_t a = 0; a < length; ++a)
+            result.tape.push_back(wrap((mark_first && a == heads[0] ? HEAD : "") + tapes[0][a] + SIGN
+                + (mark_second && a == heads[1] ? HEAD : "") + tapes[1][a]));
+    }
+};
+
+// Runs the one-taped machine (as tm_interpreter does) for the given number of steps
+static bool run_one_taped(const TuringMachine &tm, ShadowResult &config, unsigned long long steps)
+{
+    for (; steps > 0; --steps)
+    {
+        auto trans = tm.transitions().find(make_pair(config.state, vector<string>{config.tape[config.head]}));
+        if (trans == tm.transitions().end())
+            return false;
+        auto &[new_state, new_letters, directions] = trans->second;
+        config.state = new_state;
+        config.tape[config.head] = new_letters[0];
+        if (directions[0] == HEAD_LEFT && !config.head)
+            return false;
+        config.head += directions[0] == HEAD_LEFT ? -1 : directions[0] == HEAD_RIGHT ? 1 : 0;
+        if (config.head >= config.tape.size())
+            config.tape.emplace_back(BLANK);
+    }
+    return true;
+}
+
+static void check(const TuringMachine &one_taped_tm, ShadowResult config, unsigned long long steps, const ShadowResult &expected,
+    uint64_t seed)
+{
+    if (!run_one_taped(one_taped_tm, config, steps) || config.state != expected.state 
+        || config.head != expected.head || config.tape != expected.tape)
+    {
+        cerr << "ERROR: Shadow check failed, the one-taped machine is in state " << config.state 
+             << " instead of " << expected.state << " (--seed " << seed << ")\n";
+        exit(1);
+    }
+}
+
+ShadowResult shadow_run(const TuringMachine &tm, const vector<string> &input, size_t check_every, uint64_t seed)
+{
+    if (tm.num_tapes != 2)
+    {
+        cout << "Provided machine is not two-taped!\n";
+        exit(1);
+    }
+    TuringMachine one_taped_tm = check_every ? tm_convert(tm) : tm;
+    mt19937_64 random(seed);
+    size_t checks = 0;
+
+    Shadow shadow(tm);
+    bool running = shadow.start(input);
+    if (check_every && running)
+    {
+        // Phase 0 is always checked
+        ShadowResult initial{false, 0, INITIAL_STATE, input.empty() ? vector<string>{BLANK} : input, 0, 0};
+        shadow.set_cycle_start();
+        check(one_taped_tm, initial, shadow.steps, shadow.result, seed);
+        ++checks;
+    }
+    while (running)
+    {
+        if (check_every && random() % check_every == 0)
+        {
+            shadow.set_cycle_start();
+            ShadowResult before = shadow.result;
+            unsigned long long steps = shadow.steps;
+            running = shadow.cycle();
+            if (running)
+                shadow.set_cycle_start();
+            check(one_taped_tm, before, shadow.steps - steps, shadow.result, seed);
+            ++checks;
+        }
+        else
+            running = shadow.cycle();
+    }
+    shadow.result.checks = checks;
+    return shadow.result;
+}
@@ -0,0 +1,28 @@
+#ifndef __TM_SHADOW_H
+#define __TM_SHADOW_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "turing_machine.h"
+
+// Final configuration of the one-taped machine produced by tm_convert
+struct ShadowResult
+{
+    bool accept;
+    unsigned long long steps; // of the one-taped machine
+    std::string state;
+    std::vector<std::string> tape;
+    size_t head;
+    size_t checks; // spot checks passed
+};
+
+// Runs the original two-taped machine and computes (without running it) the run
+// of the one-taped machine produced by tm_convert. Cycles of the one-taped machine
+// (simulating one original step) are verified by running it, each with probability 1 / check_every
+// (0 - no checks). The checked cycles are drawn from a generator seeded with seed, which
+// is reported if a check fails, so that the failing run can be repeated.
+ShadowResult shadow_run(const TuringMachine &tm, const std::vector<std::string> &input, size_t check_every, uint64_t seed);
+
+#endif
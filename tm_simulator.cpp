@@ -0,0 +1,153 @@
+#include <sstream>
+#include "tm_simulator.h"
+
+using namespace std;
+
+void print_configuration(ostream &output, const string &state,
+    const vector<vector<string>> &tapes, const vector<size_t> &heads) {
+    output << "State: " << state << "\n";
+    for (size_t a = 0; a < tapes.size(); ++a) {
+        size_t before_head = 0, after_head = 0;
+        ostringstream oss;
+        oss << "Tape " << (a + 1) << ": ";
+        for (size_t b = 0; b < tapes[a].size(); ++b) {
+            if (b == heads[a])
+                before_head = oss.str().length();
+            oss << tapes[a][b];
+            if (b == heads[a])
+                after_head = oss.str().length();
+        }
+        output << oss.str() << "\n";
+        for (size_t b = 0; b < before_head; ++b)
+            output << " ";
+        for (size_t b = before_head; b < after_head; ++b)
+            output << "^";
+        output << "\n";
+    }
+    output << "#####################################\n";
+}
+
+inline int head_move(char dir) {
+    return dir == HEAD_LEFT ? -1 : dir == HEAD_RIGHT ? 1 : 0;
+}
+
+Simulator::Simulator(const TuringMachine &machine) : tm(machine) {
+    reset(vector<string>());
+}
+
+Simulator::Simulator(const TuringMachine &machine, const string &input) : tm(machine) {
+    reset(input);
+}
+
+SimulatorStatus Simulator::reset(const string &input) {
+    vector<string> word = tm.parse_input(input);
+    reset(word);
+    if (word.empty() && input != "") {
+        status_ = SIM_ERROR;
+        message_ = "Input is not a sequence of input letters";
+    }
+    return status_;
+}
+
+SimulatorStatus Simulator::reset(const vector<string> &word) {
+    tapes_.resize(tm.num_tapes);
+    heads_.assign(tm.num_tapes, 0);
+    for (auto &tape : tapes_)
+        tape.clear();
+    tapes_[0].assign(word.begin(), word.end());
+    append_blanks_under_heads();
+    state_ = INITIAL_STATE;
+    steps_ = 0;
+    message_.clear();
+    update_status();
+    return status_;
+}
+
+// returns mask of tapes extended by a blank
+unsigned Simulator::append_blanks_under_heads() {
+    unsigned appended = 0;
+    for (size_t a = 0; a < tapes_.size(); ++a)
+        if (heads_[a] >= tapes_[a].size()) {
+            tapes_[a].emplace_back(BLANK);
+            appended |= 1u << a;
+        }
+    return appended;
+}
+
+void Simulator::update_status() {
+    status_ = state_ == ACCEPTING_STATE ? SIM_ACCEPT : state_ == REJECTING_STATE ? SIM_REJECT : SIM_RUNNING;
+}
+
+const transition_t *Simulator::next_transition() {
+    if (status_ != SIM_RUNNING)
+        return nullptr;
+    current.first = state_;
+    current.second.resize(tapes_.size());
+    for (size_t a = 0; a < tapes_.size(); ++a)
+        current.second[a] = tapes_[a][heads_[a]];
+    auto it = tm.transitions().find(current);
+    if (it == tm.transitions().end() && expander && expander(state_))
+        it = tm.transitions().find(current);
+    if (it == tm.transitions().end()) {
+        message_ = "No transition from this configuration";
+        return nullptr;
+    }
+    for (size_t a = 0; a < tapes_.size(); ++a)
+        if (get<2>(it->second)[a] == HEAD_LEFT && !heads_[a]) {
+            message_ = "Head " + to_string(a + 1) + " falls off the tape in the next transition";
+            return nullptr;
+        }
+    return &*it;
+}
+
+unsigned Simulator::apply(const transition_t &trans) {
+    state_ = get<0>(trans.second);
+    for (size_t a = 0; a < tapes_.size(); ++a) {
+        tapes_[a][heads_[a]] = get<1>(trans.second)[a];
+        heads_[a] += head_move(get<2>(trans.second)[a]);
+    }
+    ++steps_;
+    update_status();
+    return append_blanks_under_heads();
+}
+
+void Simulator::undo(const transition_t &trans, unsigned appended) {
+    for (size_t a = 0; a < tapes_.size(); ++a) {
+        if (appended & (1u << a))
+            tapes_[a].pop_back();
+        heads_[a] -= head_move(get<2>(trans.second)[a]);
+        tapes_[a][heads_[a]] = trans.first.second[a];
+    }
+    state_ = trans.first.first;
+    --steps_;
+    message_.clear();
+    update_status();
+}
+
+void Simulator::set_configuration(const string &state, const vector<vector<string>> &tapes,
+    const vector<size_t> &heads, size_t steps) {
+    state_ = state;
+    tapes_ = tapes;
+    heads_ = heads;
+    steps_ = steps;
+    message_.clear();
+    update_status();
+}
+
+SimulatorStatus Simulator::run(size_t budget) {
+    for (; budget && status_ == SIM_RUNNING; --budget) {
+        auto trans = next_transition();
+        if (!trans) {
+            status_ = SIM_REJECT;
+            break;
+        }
+        if (hits)
+            ++(*hits)[trans];
+        apply(*trans);
+    }
+    return status_;
+}
+
+void Simulator::print_configuration(ostream &output) const {
+    ::print_configuration(output, state_, tapes_, heads_);
+}
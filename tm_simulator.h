@@ -0,0 +1,80 @@
+#ifndef __TM_SIMULATOR_H
+#define __TM_SIMULATOR_H
+
+#include <cstddef>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "turing_machine.h"
+
+enum SimulatorStatus { SIM_RUNNING, SIM_ACCEPT, SIM_REJECT, SIM_ERROR };
+
+typedef transitions_t::value_type transition_t;
+
+// Called when no transition from the current configuration is known; returns true if
+// transitions leaving the state were added to the machine (machines built lazily)
+typedef std::function<bool(const std::string &state)> StateExpander;
+
+void print_configuration(std::ostream &output, const std::string &state,
+    const std::vector<std::vector<std::string>> &tapes, const std::vector<size_t> &heads);
+
+// Run of a deterministic machine, which can be interrupted and resumed.
+// The machine is not copied - it has to outlive the simulator.
+// Nothing is printed and the process is never terminated; the reason of a rejection
+// without reaching (reject) or of an error is given by message().
+class Simulator {
+public:
+    Simulator(const TuringMachine &tm);
+    Simulator(const TuringMachine &tm, const std::string &input);
+
+    // Starts a new run; allocated tapes are reused. An input which is not
+    // a sequence of input letters sets the status to SIM_ERROR.
+    SimulatorStatus reset(const std::string &input);
+    SimulatorStatus reset(const std::vector<std::string> &word);
+
+    // Executes at most budget steps; returns SIM_RUNNING if the machine has not halted yet
+    SimulatorStatus run(size_t budget);
+    SimulatorStatus step() { return run(1); }
+
+    SimulatorStatus status() const { return status_; }
+    const std::string &message() const { return message_; }
+    size_t steps() const { return steps_; }
+    const TuringMachine &machine() const { return tm; }
+    void set_expander(StateExpander state_expander) { expander = state_expander; }
+    // Transitions executed by run() are counted in counter (profiling); nullptr - no counting
+    void set_hit_counter(std::unordered_map<const transition_t *, unsigned long long> *counter) { hits = counter; }
+
+    const std::string &state() const { return state_; }
+    const std::vector<std::vector<std::string>> &tapes() const { return tapes_; }
+    const std::vector<size_t> &heads() const { return heads_; }
+    void print_configuration(std::ostream &output) const;
+
+    // Low level access for debuggers: transition executed in the current configuration
+    // (nullptr if the machine halts), executing and undoing it. apply() returns the mask of tapes
+    // extended by a blank, which has to be passed to undo().
+    const transition_t *next_transition();
+    unsigned apply(const transition_t &trans);
+    void undo(const transition_t &trans, unsigned appended);
+    void set_configuration(const std::string &state, const std::vector<std::vector<std::string>> &tapes,
+        const std::vector<size_t> &heads, size_t steps);
+
+private:
+    const TuringMachine &tm;
+    SimulatorStatus status_;
+    std::string message_;
+    size_t steps_;
+    std::string state_;
+    std::vector<std::vector<std::string>> tapes_;
+    std::vector<size_t> heads_;
+    std::pair<std::string, std::vector<std::string>> current; // lookup key, reused in every step
+    StateExpander expander;
+    std::unordered_map<const transition_t *, unsigned long long> *hits = nullptr;
+
+    unsigned append_blanks_under_heads();
+    void update_status();
+};
+
+#endif
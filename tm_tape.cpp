@@ -0,0 +1,235 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "tm_tape.h"
+
+using namespace std;
+
+void VectorTape::print_stats(ostream &output) const
+{
+    output << cells.size() << " cells in memory";
+}
+
+void RunLengthTape::clear()
+{
+    spans.clear();
+    extent = 0;
+    current_start = current_end = 0;
+}
+
+int32_t RunLengthTape::find(size_t pos)
+{
+    if (pos >= extent)
+        return 0;
+    auto it = prev(spans.upper_bound(pos));
+    current_start = it->first;
+    current_end = it->second.end;
+    current_letter = it->second.letter;
+    return current_letter;
+}
+
+void RunLengthTape::write(size_t pos, int32_t letter)
+{
+    if (read(pos) == letter)
+        return;
+    current_start = current_end = 0;
+    if (pos >= extent)
+    {
+        // Past the stored runs (so letter is not blank)
+        if (pos == extent && !spans.empty() && prev(spans.end())->second.letter == letter)
+            prev(spans.end())->second.end = pos + 1;
+        else
+        {
+            if (pos > extent)
+                spans.emplace_hint(spans.end(), extent, Run{pos, 0});
+            spans.emplace_hint(spans.end(), pos, Run{pos + 1, letter});
+        }
+        extent = pos + 1;
+        return;
+    }
+
+    // Split the run at pos into [start, pos), [pos, pos + 1), [pos + 1, end)
+    auto it = prev(spans.upper_bound(pos));
+    Run old = it->second;
+    if (pos + 1 < old.end)
+        spans.emplace_hint(next(it), pos + 1, old);
+    if (it->first < pos)
+    {
+        it->second.end = pos;
+        it = spans.emplace_hint(next(it), pos, Run{pos + 1, letter});
+    }
+    else
+        it->second = Run{pos + 1, letter};
+
+    // Merge with equal neighbours
+    auto after = next(it);
+    if (after != spans.end() && after->second.letter == letter)
+    {
+        it->second.end = after->second.end;
+        spans.erase(after);
+    }
+    if (it != spans.begin() && prev(it)->second.letter == letter)
+    {
+        auto before = prev(it);
+        before->second.end = it->second.end;
+        spans.erase(it);
+        it = before;
+    }
+    // Trailing blanks are not stored
+    if (!letter && next(it) == spans.end())
+    {
+        extent = it->first;
+        spans.erase(it);
+    }
+}
+
+void RunLengthTape::print_stats(ostream &output) const
+{
+    output << spans.size() << " runs covering " << extent << " cells";
+}
+
+string default_scratch_dir()
+{
+    const char *tmpdir = getenv("TMPDIR");
+    return tmpdir && *tmpdir ? tmpdir : "/var/tmp";
+}
+
+PagedTape::PagedTape(size_t page_cells, size_t resident_pages, const string &scratch_dir)
+    : shift(0), resident_limit(max<size_t>(resident_pages, 1)), directory(scratch_dir)
+{
+    while (((size_t)1 << shift) < page_cells)
+        ++shift;
+    if (((size_t)1 << shift) != page_cells || page_cells < 1024)
+        throw invalid_argument("Page size has to be a power of two, at least 1024");
+    mask = page_cells - 1;
+    void *blank = mmap(nullptr, page_cells * sizeof(int32_t), PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (blank == MAP_FAILED)
+        throw runtime_error("Cannot map the blank page");
+    blank_page = (int32_t *)blank;
+}
+
+PagedTape::~PagedTape()
+{
+    for (size_t page : resident)
+        munmap(pages[page].cells, (mask + 1) * sizeof(int32_t));
+    munmap(blank_page, (mask + 1) * sizeof(int32_t));
+    if (fd >= 0)
+        close(fd);
+}
+
+void PagedTape::clear()
+{
+    for (size_t page : resident)
+        munmap(pages[page].cells, (mask + 1) * sizeof(int32_t));
+    resident.clear();
+    pages.clear();
+    free_slots.clear();
+    slots = 0;
+    if (fd >= 0 && ftruncate(fd, 0))
+        throw runtime_error("Cannot truncate the scratch file");
+    cached_page = SIZE_MAX;
+    cached = nullptr;
+    cached_writable = false;
+}
+
+// Caches the page under the head; pages holding only blanks are read from blank_page
+void PagedTape::locate(size_t page, bool for_write)
+{
+    if (!for_write && !is_stored(page))
+    {
+        cached_page = page;
+        cached = blank_page;
+        cached_writable = false;
+        return;
+    }
+    enter(page);
+}
+
+// Maps the page into memory (evicting another one if necessary)
+void PagedTape::enter(size_t page)
+{
+    const size_t bytes = (mask + 1) * sizeof(int32_t);
+    if (page >= pages.size())
+        pages.resize(page + 1);
+    if (!pages[page].cells)
+    {
+        if (resident.size() >= resident_limit)
+        {
+            auto victim = min_element(resident.begin(), resident.end(),
+                [&](size_t a, size_t b) { return pages[a].entered < pages[b].entered; });
+            evict(*victim);
+            *victim = resident.back();
+            resident.pop_back();
+        }
+        if (fd < 0)
+        {
+            string name = directory + "/tm_tape_XXXXXX";
+            vector<char> buffer(name.begin(), name.end());
+            buffer.push_back('\0');
+            fd = mkstemp(buffer.data());
+            if (fd < 0)
+                throw runtime_error("Cannot create a scratch file in " + directory);
+            unlink(buffer.data());
+        }
+        // New slots are zero-filled by ftruncate, freed slots hold only blanks
+        Page &p = pages[page];
+        if (p.slot < 0)
+        {
+            if (!free_slots.empty())
+            {
+                p.slot = free_slots.back();
+                free_slots.pop_back();
+            }
+            else
+            {
+                p.slot = slots++;
+                if (ftruncate(fd, slots * bytes))
+                    throw runtime_error("Cannot extend the scratch file");
+            }
+        }
+        void *cells = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, p.slot * bytes);
+        if (cells == MAP_FAILED)
+            throw runtime_error("Cannot map a page of the scratch file");
+        p.cells = (int32_t *)cells;
+        resident.push_back(page);
+        ++faults;
+    }
+    pages[page].entered = ++clock;
+    cached_page = page;
+    cached = pages[page].cells;
+    cached_writable = true;
+}
+
+// Unmaps the page; the kernel writes it back to the scratch file, unless it holds only blanks
+void PagedTape::evict(size_t page)
+{
+    Page &p = pages[page];
+    const size_t cells = mask + 1;
+    if (all_of(p.cells, p.cells + cells, [](int32_t letter) { return letter == 0; }))
+    {
+        free_slots.push_back(p.slot);
+        p.slot = -1;
+    }
+    munmap(p.cells, cells * sizeof(int32_t));
+    p.cells = nullptr;
+    if (cached_page == page)
+    {
+        cached_page = SIZE_MAX;
+        cached = nullptr;
+        cached_writable = false;
+    }
+}
+
+void PagedTape::print_stats(ostream &output) const
+{
+    size_t stored = 0;
+    for (auto &p : pages)
+        stored += p.slot >= 0;
+    output << pages.size() << " pages of " << mask + 1 << " cells, " << resident.size() << " in memory, "
+           << stored << " stored in the scratch file (" << (slots * (mask + 1) * sizeof(int32_t) >> 20)
+           << " MB), " << faults << " page faults";
+}
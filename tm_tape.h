@@ -0,0 +1,147 @@
+#ifndef __TM_TAPE_H
+#define __TM_TAPE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Tape of letter numbers (0 - blank), infinite to the right: cells never written are blank
+class Tape
+{
+public:
+    virtual ~Tape() {}
+    virtual void clear() = 0;
+    virtual int32_t read(size_t pos) = 0;
+    virtual void write(size_t pos, int32_t letter) = 0;
+    // Cells up to the last non-blank one (or a little more)
+    virtual size_t length() const = 0;
+    virtual void print_stats(std::ostream &output) const = 0;
+};
+
+// All cells in memory; final, so that calls through VectorTape pointers are inlined
+class VectorTape final : public Tape
+{
+public:
+    void clear() override { cells.clear(); }
+    int32_t read(size_t pos) override { return pos < cells.size() ? cells[pos] : 0; }
+    void write(size_t pos, int32_t letter) override
+    {
+        if (pos >= cells.size())
+        {
+            if (!letter)
+                return;
+            cells.resize(pos + 1, 0);
+        }
+        cells[pos] = letter;
+    }
+    size_t length() const override { return cells.size(); }
+    void print_stats(std::ostream &output) const override;
+
+private:
+    std::vector<int32_t> cells;
+};
+
+// Cells as runs of one letter, split only where a write changes a letter and merged
+// with equal neighbours; memory is O(number of runs)
+class RunLengthTape final : public Tape
+{
+public:
+    void clear() override;
+    int32_t read(size_t pos) override
+    {
+        // Run under the head is cached
+        if (pos - current_start < current_end - current_start)
+            return current_letter;
+        return find(pos);
+    }
+    void write(size_t pos, int32_t letter) override;
+    size_t length() const override { return extent; }
+    void print_stats(std::ostream &output) const override;
+
+private:
+    struct Run
+    {
+        size_t end;
+        int32_t letter;
+    };
+
+    std::map<size_t, Run> spans; // by start; they cover [0, extent), the last one is not blank
+    size_t extent = 0;
+    size_t current_start = 0, current_end = 0;
+    int32_t current_letter = 0;
+
+    int32_t find(size_t pos);
+};
+
+// Directory of scratch files by default: $TMPDIR if set, otherwise /var/tmp
+// (not /tmp, which is kept in memory on many systems)
+std::string default_scratch_dir();
+
+// Cells in pages of page_cells; at most resident_pages pages (the least recently entered ones
+// are evicted) are mapped into memory from a scratch file, created (and immediately unlinked)
+// in scratch_dir on the first use. Pages holding only blanks are not kept in the file;
+// reading them maps nothing, a slot is allocated on the first non-blank write.
+class PagedTape : public Tape
+{
+public:
+    // page_cells - power of two, at least 1024
+    PagedTape(size_t page_cells = 1 << 16, size_t resident_pages = 16, const std::string &scratch_dir = default_scratch_dir());
+    ~PagedTape();
+    PagedTape(const PagedTape &) = delete;
+    PagedTape &operator=(const PagedTape &) = delete;
+
+    void clear() override;
+    int32_t read(size_t pos) override
+    {
+        if ((pos >> shift) != cached_page)
+            locate(pos >> shift, false);
+        return cached[pos & mask];
+    }
+    void write(size_t pos, int32_t letter) override
+    {
+        if ((pos >> shift) != cached_page || !cached_writable)
+        {
+            if (!letter && !is_stored(pos >> shift))
+                return;
+            locate(pos >> shift, true);
+        }
+        cached[pos & mask] = letter;
+    }
+    size_t length() const override { return pages.size() << shift; }
+    void print_stats(std::ostream &output) const override;
+
+private:
+    struct Page
+    {
+        int32_t *cells = nullptr; // mapped, nullptr if not in memory
+        long long slot = -1; // in the scratch file, -1 - only blanks
+        unsigned long long entered = 0; // for eviction of the least recently entered
+    };
+
+    size_t shift, mask, resident_limit;
+    std::string directory;
+    int fd = -1;
+    std::vector<Page> pages;
+    std::vector<size_t> resident;
+    std::vector<long long> free_slots;
+    long long slots = 0; // size of the scratch file in pages
+    unsigned long long clock = 0, faults = 0;
+    int32_t *blank_page; // read-only anonymous mapping, backed by the kernel's zero page
+    size_t cached_page = SIZE_MAX; // page under the head
+    int32_t *cached = nullptr;
+    bool cached_writable = false; // false if cached is blank_page
+
+    bool is_stored(size_t page) const
+    {
+        return page < pages.size() && (pages[page].cells || pages[page].slot >= 0);
+    }
+    void locate(size_t page, bool for_write);
+    void enter(size_t page);
+    void evict(size_t page);
+};
+
+#endif
@@ -1,23 +1,87 @@
 #include <iostream>
 #include <sstream>
 #include <cstddef>
+#include <cstdint>
 #include <cstdlib>
 #include <fstream>
 #include "turing_machine.h"
 #include "tm_convert.h"
+#include "tm_optimize.h"
+#include "tm_layout.h"
 
 using namespace std;
 
-int main(int argc, char* argv[]) 
+static void print_usage(string error) 
+{
+    cerr << "ERROR: " << error << "\n"
+         << "Usage: tm_translator [-i|--incremental] [-O|--optimize] [-b|--binary] [-s|--stats]\n"
+         << "                     [-p|--profile <profile_file>] <input_file> [output_file]\n";
+    exit(1);
+}
+
+// FNV-1a, identifies the output described by the record of an incremental translation
+static uint64_t checksum(const string &text)
 {
-    if (argc < 2)
+    uint64_t hash = 14695981039346656037ull;
+    for (const char *c = text.data(), *end = c + text.size(); c != end; ++c)
     {
-        cerr << "ERROR: .tm file not provided!" << endl;
-        return 1;
+        hash ^= (unsigned char)*c;
+        hash *= 1099511628211ull;
     }
+    return hash;
+}
 
-    string filename = argv[1];
-    string outputname = argc > 2 ? argv[2] : "single_taped_translation.tm";
+static string read_file(const string &name)
+{
+    ifstream file(name);
+    ostringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+}
+
+int main(int argc, char* argv[]) 
+{
+    string filename;
+    string outputname = "single_taped_translation.tm";
+    bool incremental = false;
+    bool optimize = false;
+    bool binary = false;
+    bool stats = false;
+    string profilename;
+    int ok = 0;
+    for (int i = 1; i < argc; i++) 
+    {
+        string arg = argv[i];
+        if (arg == "-i" || arg == "--incremental")
+            incremental = true;
+        else if (arg == "-O" || arg == "--optimize")
+            optimize = true;
+        else if (arg == "-b" || arg == "--binary")
+            binary = true;
+        else if (arg == "-s" || arg == "--stats")
+            stats = true;
+        else if (arg == "-p" || arg == "--profile")
+        {
+            if (i + 1 >= argc)
+                print_usage("Profile file expected after " + arg);
+            profilename = argv[++i];
+        }
+        else 
+        {
+            if (ok == 0)
+                filename = arg;
+            else
+            if (ok == 1)
+                outputname = arg;
+            else
+                print_usage("Too many arguments");
+            ++ok;
+        }
+    }
+    if (ok == 0)
+        print_usage(".tm file not provided!");
+    if (binary && incremental)
+        print_usage("Incremental translation is not supported with binary encoding");
 
     FILE *f = fopen(filename.c_str(), "r");
     if (!f) 
@@ -26,14 +90,73 @@ int main(int argc, char* argv[])
         return 1;
     }
     TuringMachine tm = read_tm_from_file(f);
+    if (optimize)
+        tm = tm_optimize(tm);
 
-    TuringMachine one_taped_tm = tm_convert(tm);
+    // The record of the previous translation is kept next to the output, so that only states
+    // derived from edited transitions are regenerated. It is used only if the output is still
+    // the one it describes (not overwritten since by another translation).
+    string recordname = outputname + ".record";
+    ConversionRecord record;
+    if (incremental) 
+    {
+        ifstream record_file(recordname);
+        if (record_file && !read_conversion_record(record_file, checksum(read_file(outputname)), record))
+        {
+            cerr << "Record " << recordname << " does not match " << outputname << ", converting all states\n";
+            record = ConversionRecord();
+        }
+    }
+
+    TuringMachine one_taped_tm = binary ? tm_convert_binary(tm) : tm_convert_incremental(tm, record);
+
+    if (stats)
+    {
+        // One cell of the original machine takes 1 cell (or a block of 2b + 2 binary cells),
+        // so every simulated step costs about 4 * (cells per original cell) * (tape length) steps.
+        size_t alphabet = tm.working_alphabet().size(), bits = 1;
+        while ((1u << bits) < alphabet)
+            ++bits;
+        cerr << "Encoding: " << (binary ? "binary" : "letter pairs") << "\n"
+             << "States: " << one_taped_tm.set_of_states().size() << "\n"
+             << "Letters: " << one_taped_tm.working_alphabet().size() << "\n"
+             << "Transitions: " << one_taped_tm.transitions().size() << "\n"
+             << "Cells per original cell: " << (binary ? 2 * bits + 2 : 1) << "\n";
+    }
 
+    // Numbering of states and letters for dense tables of later runs (tm_interpreter --sweep),
+    // from the profile of a run of the previous translation (tm_interpreter --profile)
+    if (!profilename.empty())
+    {
+        ifstream profile_file(profilename);
+        profile_t profile;
+        if (!profile_file || !read_profile(profile_file, profile))
+        {
+            cerr << "ERROR: Cannot read profile " << profilename << endl;
+            return 1;
+        }
+        Layout layout = profile_layout(one_taped_tm, profile);
+        ofstream layout_file(outputname + ".layout");
+        save_layout(layout_file, layout);
+        cerr << "Layout: " << layout.states.size() << " hot states of " << one_taped_tm.set_of_states().size()
+             << ", " << layout.letters.size() << " hot letters of " << one_taped_tm.working_alphabet().size() << "\n";
+    }
+
+    // formatted once for the file, the checksum and the standard output
+    ostringstream output;
+    output << one_taped_tm;
+    string text = output.str();
     ofstream one_taped_tm_file;
     one_taped_tm_file.open(outputname);
-    one_taped_tm_file << one_taped_tm;
+    one_taped_tm_file << text;
     one_taped_tm_file.close();
 
-    cout << one_taped_tm;
+    if (incremental) 
+    {
+        cerr << "Regenerated " << record.regenerated_states << " of " << record.states.size() << " derived states\n";
+        ofstream record_file(recordname);
+        save_conversion_record(record_file, record, checksum(text));
+    }
+
+    cout << text;
 }
- 
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cassert>
 #include <cstddef>
 #include <cstdio>
@@ -5,6 +6,8 @@
 #include <iostream>
 #include <set>
 #include <string>
+#include <string_view>
+#include <unordered_set>
 #include "turing_machine.h"
 
 using namespace std;
@@ -57,7 +60,7 @@ public:
 
 private:
     FILE *input;
-    int next_char; // we always have the next char here
+    int next_char = 0; // we always have the next char here
     int line = 1;
     
     int get_next_char() 
@@ -95,7 +98,7 @@ static bool is_direction(int ch)
 // searches for an identifier starting from position pos;
 // at the end pos is the position after the identifier
 // (if false returned, pos remains unchanged)
-static bool check_identifier(string ident, size_t &pos) 
+static bool check_identifier(const string &ident, size_t &pos) 
 {
     if (pos >= ident.size())
         return false;
@@ -114,32 +117,70 @@ static bool check_identifier(string ident, size_t &pos)
     return true;
 }
 
-static bool is_identifier(string ident) {
+static bool is_identifier(const string &ident) {
     size_t pos = 0;
     return check_identifier(ident, pos) && pos == ident.length();
 }
 
-TuringMachine::TuringMachine(int num_tapes_, vector<string> input_alphabet_, transitions_t transitions_)
-    : num_tapes(num_tapes_), input_alphabet(input_alphabet_), transitions(transitions_) {
+// identifiers already checked by validate(); states and letters repeat in most transitions
+class IdentifierTable {
+public:
+    bool is_identifier(const string &ident) {
+        if (valid.count(ident))
+            return true;
+        if (!::is_identifier(ident))
+            return false;
+        valid.insert(ident);
+        return true;
+    }
+
+private:
+    unordered_set<string> valid;
+};
+
+template<typename Transitions>
+static void validate(int num_tapes, const vector<string> &input_alphabet, const Transitions &transitions) {
     assert(num_tapes > 0);
     assert(!input_alphabet.empty());
-    for (auto letter : input_alphabet)
-        assert(is_identifier(letter) && letter != BLANK);
-    for (auto transition : transitions) {
-        auto state_before = transition.first.first;
-        auto letters_before = transition.first.second;
-        auto state_after = get<0>(transition.second);
-        auto letters_after = get<1>(transition.second);
-        auto directions = get<2>(transition.second);
-        assert(is_identifier(state_before) && state_before != ACCEPTING_STATE && state_before != REJECTING_STATE && is_identifier(state_after));
+    IdentifierTable table;
+    for (auto &letter : input_alphabet)
+        assert(table.is_identifier(letter) && letter != BLANK);
+    for (auto &transition : transitions) {
+        auto &state_before = transition.first.first;
+        auto &letters_before = transition.first.second;
+        auto &state_after = get<0>(transition.second);
+        auto &letters_after = get<1>(transition.second);
+        auto &directions = get<2>(transition.second);
+        assert(table.is_identifier(state_before) && state_before != ACCEPTING_STATE && state_before != REJECTING_STATE && table.is_identifier(state_after));
         assert(letters_before.size() == (size_t)num_tapes && letters_after.size() == (size_t)num_tapes && directions.length() == (size_t)num_tapes);
         for (int a = 0; a < num_tapes; ++a)
         {
-            assert(is_identifier(letters_before[a]) && is_identifier(letters_after[a]) && is_direction(directions[a]));
+            assert(table.is_identifier(letters_before[a]) && table.is_identifier(letters_after[a]) && is_direction(directions[a]));
         }
     }
 }
 
+TuringMachine::TuringMachine(int num_tapes_, vector<string> input_letters, transitions_t all_transitions)
+    : num_tapes(num_tapes_), input_alphabet_(std::move(input_letters)), transitions_(std::move(all_transitions)) {
+    validate(num_tapes, input_alphabet_, transitions_);
+}
+
+size_t TuringMachine::add_transitions(const transitions_t &more) {
+    validate(num_tapes, input_alphabet_, more);
+    size_t before = transitions_.size();
+    transitions_.insert(more.begin(), more.end());
+    if (transitions_.size() != before) {
+        lock_guard<mutex> guard(sets.lock);
+        sets.alphabet_ready = sets.states_ready = false;
+    }
+    return transitions_.size() - before;
+}
+
+NondeterministicTuringMachine::NondeterministicTuringMachine(int num_tapes_, vector<string> input_alphabet_, nd_transitions_t transitions_)
+    : num_tapes(num_tapes_), input_alphabet(std::move(input_alphabet_)), transitions(std::move(transitions_)) {
+    validate(num_tapes, input_alphabet, transitions);
+}
+
 #define syntax_error(reader, message) \
     for(;;) { \
         cerr << "Syntax error in line " << reader.get_line_num() << ": " << message << "\n"; \
@@ -159,11 +200,12 @@ static string read_identifier(Reader &reader) {
 #define NUM_TAPES "num-tapes:"
 #define INPUT_ALPHABET "input-alphabet:"
 
-TuringMachine read_tm_from_file(FILE *input) {
+// reads the whole file; duplicate (state, letters) are allowed only for nondeterministic machines
+template<typename Transitions>
+static void read_machine(FILE *input, int &num_tapes, vector<string> &input_alphabet, Transitions &transitions, bool deterministic) {
     Reader reader(input);
 
     // number of tapes
-    int num_tapes;
     if (!reader.is_next_token_available() || reader.next_token() != NUM_TAPES)
         syntax_error(reader, "\"" NUM_TAPES "\" expected");
     try {
@@ -182,7 +224,6 @@ TuringMachine read_tm_from_file(FILE *input) {
     reader.go_to_next_line();
     
     // input alphabet
-    vector<string> input_alphabet;
     if (!reader.is_next_token_available() || reader.next_token() != INPUT_ALPHABET)
         syntax_error(reader, "\"" INPUT_ALPHABET "\" expected");
     while (reader.is_next_token_available()) {
@@ -195,7 +236,6 @@ TuringMachine read_tm_from_file(FILE *input) {
     reader.go_to_next_line();
     
     // transitions
-    transitions_t transitions;
     while (reader.is_next_token_available()) {
         string state_before = read_identifier(reader);
         if (state_before == "(accept)" || state_before == "(reject)")
@@ -205,7 +245,7 @@ TuringMachine read_tm_from_file(FILE *input) {
         for (int a = 0; a < num_tapes; ++a)
             letters_before.emplace_back(read_identifier(reader));
 
-        if (transitions.find(make_pair(state_before, letters_before)) != transitions.end())
+        if (deterministic && transitions.find(make_pair(state_before, letters_before)) != transitions.end())
             syntax_error(reader, "The machine is not deterministic");
 
         string state_after = read_identifier(reader);
@@ -226,59 +266,85 @@ TuringMachine read_tm_from_file(FILE *input) {
             syntax_error(reader, "Too many tokens in a line");
         reader.go_to_next_line();
         
-        transitions[make_pair(state_before, letters_before)] = make_tuple(state_after, letters_after, directions);
+        transitions.emplace(make_pair(state_before, letters_before), make_tuple(state_after, letters_after, directions));
     }
-    
-    return TuringMachine(num_tapes, input_alphabet, transitions);
 }
 
-vector<string> TuringMachine::working_alphabet() const {
-    set<string> letters(input_alphabet.begin(), input_alphabet.end());
+TuringMachine read_tm_from_file(FILE *input) {
+    int num_tapes;
+    vector<string> input_alphabet;
+    transitions_t transitions;
+    read_machine(input, num_tapes, input_alphabet, transitions, true);
+    return TuringMachine(num_tapes, std::move(input_alphabet), std::move(transitions));
+}
+
+NondeterministicTuringMachine read_ntm_from_file(FILE *input) {
+    int num_tapes;
+    vector<string> input_alphabet;
+    nd_transitions_t transitions;
+    read_machine(input, num_tapes, input_alphabet, transitions, false);
+    return NondeterministicTuringMachine(num_tapes, std::move(input_alphabet), std::move(transitions));
+}
+
+// sorted distinct names; the views point into the machine
+static vector<string> sorted(const unordered_set<string_view> &names) {
+    vector<string> res(names.begin(), names.end());
+    sort(res.begin(), res.end());
+    return res;
+}
+
+const vector<string> &TuringMachine::working_alphabet() const {
+    lock_guard<mutex> guard(sets.lock);
+    if (sets.alphabet_ready)
+        return sets.alphabet;
+    unordered_set<string_view> letters(input_alphabet_.begin(), input_alphabet_.end());
     letters.insert(BLANK);
-    for (auto transition : transitions) {
-        auto letters_before = transition.first.second;
-        auto letters_after = get<1>(transition.second);
-        letters.insert(letters_before.begin(), letters_before.end());
-        letters.insert(letters_after.begin(), letters_after.end());
+    for (auto &transition : transitions_) {
+        letters.insert(transition.first.second.begin(), transition.first.second.end());
+        letters.insert(get<1>(transition.second).begin(), get<1>(transition.second).end());
     }
-    return vector<string>(letters.begin(), letters.end());
+    sets.alphabet = sorted(letters);
+    sets.alphabet_ready = true;
+    return sets.alphabet;
 }
     
-vector<string> TuringMachine::set_of_states() const {
-    set<string> states;
-    states.insert(INITIAL_STATE);
-    states.insert(ACCEPTING_STATE);
-    states.insert(REJECTING_STATE);
-    for (auto transition : transitions) {
+const vector<string> &TuringMachine::set_of_states() const {
+    lock_guard<mutex> guard(sets.lock);
+    if (sets.states_ready)
+        return sets.states;
+    unordered_set<string_view> states{INITIAL_STATE, ACCEPTING_STATE, REJECTING_STATE};
+    for (auto &transition : transitions_) {
         states.insert(transition.first.first);
         states.insert(get<0>(transition.second));
     }
-    return vector<string>(states.begin(), states.end());
+    sets.states = sorted(states);
+    sets.states_ready = true;
+    return sets.states;
 }
 
-static void output_vector(ostream &output, vector<string> v) {
-   for (string el : v)
+static void output_vector(ostream &output, const vector<string> &v) {
+   for (auto &el : v)
         output << " " << el;
 }
     
 void TuringMachine::save_to_file(ostream &output) const {
     output << NUM_TAPES << " " << num_tapes << "\n"
            << INPUT_ALPHABET;
-    output_vector(output, input_alphabet);
+    output_vector(output, input_alphabet_);
     output << "\n";
-    for (auto transition : transitions) {
+    for (auto &transition : transitions_) {
         output << transition.first.first;
         output_vector(output, transition.first.second);
         output << " " << get<0>(transition.second);
         output_vector(output, get<1>(transition.second));
-        string directions = get<2>(transition.second);
+        auto &directions = get<2>(transition.second);
         for (int a = 0; a < num_tapes; ++a)
             output << " " << directions[a];
         output << "\n";
     }
 }
 
-vector<string> TuringMachine::parse_input(std::string input) const {
+static vector<string> parse_word(const vector<string> &input_alphabet, const string &input) {
     set<string> alphabet(input_alphabet.begin(), input_alphabet.end());
     size_t pos = 0;
     vector<string> res;
@@ -292,3 +358,11 @@ vector<string> TuringMachine::parse_input(std::string input) const {
     }
     return res;
 }
+
+vector<string> TuringMachine::parse_input(std::string input) const {
+    return parse_word(input_alphabet_, input);
+}
+
+vector<string> NondeterministicTuringMachine::parse_input(std::string input) const {
+    return parse_word(input_alphabet, input);
+}
@@ -1,9 +1,11 @@
 #ifndef __TURING_MACHINE_H
 #define __TURING_MACHINE_H
 
+#include <cstddef>
 #include <cstdio>
 #include <iostream>
 #include <map>
+#include <mutex>
 #include <string>
 #include <tuple>
 #include <utility>
@@ -33,27 +35,57 @@ typedef std::map<
 // Two-tape: (state, [let1, let2] -> (new_state, [let1, let2], "move1 move2"))
 // One-tape: (state, [let] -> (new_state, [let], "move"))
 
+// Nondeterministic machines may have several transitions from the same (state, letters)
+typedef std::multimap<transitions_t::key_type, transitions_t::mapped_type> nd_transitions_t;
+
 struct TuringMachine 
 {
     int num_tapes;
     
-    std::vector<std::string> input_alphabet;
-    
-    transitions_t transitions;
+    // the alphabet and the transitions are moved in (pass them with std::move to avoid copies)
+    TuringMachine(int, std::vector<std::string>, transitions_t);
+
+    const std::vector<std::string> &input_alphabet() const { return input_alphabet_; }
+
     // (state, [letter_on_tape_1, ..., letter_on_tape_k])
     //    -> (new_state, [new_letter_on_tape_1, ..., new_letter_on_tape_k], [move_on_tape_1, ..., move_on_tape_k])
-    
-    TuringMachine(int, std::vector<std::string>, transitions_t);
+    const transitions_t &transitions() const { return transitions_; }
+
+    // adds transitions from (state, letters) not present yet; returns the number of added ones
+    size_t add_transitions(const transitions_t &more);
 
-    std::vector<std::string> working_alphabet() const;
+    // both sorted; computed on the first call and kept until the machine is modified.
+    // Safe to call from several threads at once.
+    const std::vector<std::string> &working_alphabet() const;
     
-    std::vector<std::string> set_of_states() const;
+    const std::vector<std::string> &set_of_states() const;
     
     void save_to_file(std::ostream &output) const;
     
     std::vector<std::string> parse_input(std::string input) const;
 
     // ERROR <=> input!="" && returned_value.empty()
+
+private:
+    std::vector<std::string> input_alphabet_;
+    transitions_t transitions_;
+
+    // copies of the machine start without the cached sets
+    struct SetsCache
+    {
+        std::mutex lock;
+        bool alphabet_ready = false, states_ready = false;
+        std::vector<std::string> alphabet, states;
+
+        SetsCache() {}
+        SetsCache(const SetsCache &) {}
+        SetsCache &operator=(const SetsCache &)
+        {
+            alphabet_ready = states_ready = false;
+            return *this;
+        }
+    };
+    mutable SetsCache sets;
 };
 
 static inline std::ostream &operator<<(std::ostream &output, const TuringMachine &tm) 
@@ -64,4 +96,19 @@ static inline std::ostream &operator<<(std::ostream &output, const TuringMachine
 
 TuringMachine read_tm_from_file(FILE *input);
 
+struct NondeterministicTuringMachine
+{
+    int num_tapes;
+    
+    std::vector<std::string> input_alphabet;
+    
+    nd_transitions_t transitions;
+    
+    NondeterministicTuringMachine(int, std::vector<std::string>, nd_transitions_t);
+
+    std::vector<std::string> parse_input(std::string input) const;
+};
+
+NondeterministicTuringMachine read_ntm_from_file(FILE *input);
+
 #endif